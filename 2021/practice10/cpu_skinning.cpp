@@ -0,0 +1,121 @@
+#include "cpu_skinning.hpp"
+
+#include <cassert>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CPU_SKINNING_SSE
+#include <immintrin.h>
+#endif
+
+namespace
+{
+
+	void resize(skinned_vertices & result, std::size_t size)
+	{
+		result.positions.resize(size);
+		result.normals.resize(size);
+	}
+
+#ifdef CPU_SKINNING_SSE
+
+	// A glm::mat4x3 is twelve packed floats, so a weighted sum of them is three
+	// four-wide sums regardless of where the columns start; the columns are then
+	// shuffled out of those sums
+	void skin_range(skinning_mesh const & mesh, glm::mat4x3 const * palette, skinned_vertices & result,
+		std::size_t begin, std::size_t end)
+	{
+		for (std::size_t v = begin; v < end; ++v)
+		{
+			auto const & joints = mesh.joints[v];
+			auto const & weights = mesh.weights[v];
+
+			__m128 sum0 = _mm_setzero_ps();
+			__m128 sum1 = _mm_setzero_ps();
+			__m128 sum2 = _mm_setzero_ps();
+
+			for (int i = 0; i < 4; ++i)
+			{
+				float const * bone = &palette[joints[i]][0][0];
+				__m128 const weight = _mm_set1_ps(weights[i]);
+				sum0 = _mm_add_ps(sum0, _mm_mul_ps(_mm_loadu_ps(bone), weight));
+				sum1 = _mm_add_ps(sum1, _mm_mul_ps(_mm_loadu_ps(bone + 4), weight));
+				sum2 = _mm_add_ps(sum2, _mm_mul_ps(_mm_loadu_ps(bone + 8), weight));
+			}
+
+			// sum0 = (c0.x, c0.y, c0.z, c1.x), sum1 = (c1.y, c1.z, c2.x, c2.y), sum2 = (c2.z, c3.x, c3.y, c3.z)
+			__m128 const column0 = sum0;
+			__m128 const column1 = _mm_shuffle_ps(_mm_shuffle_ps(sum0, sum1, _MM_SHUFFLE(0, 0, 3, 3)), sum1, _MM_SHUFFLE(1, 1, 2, 0));
+			__m128 const column2 = _mm_shuffle_ps(sum1, sum2, _MM_SHUFFLE(0, 0, 3, 2));
+			__m128 const column3 = _mm_shuffle_ps(sum2, sum2, _MM_SHUFFLE(3, 3, 2, 1));
+
+			auto const & p = mesh.positions[v];
+			auto const & n = mesh.normals[v];
+
+			__m128 const normal = _mm_add_ps(_mm_add_ps(
+				_mm_mul_ps(column0, _mm_set1_ps(n.x)),
+				_mm_mul_ps(column1, _mm_set1_ps(n.y))),
+				_mm_mul_ps(column2, _mm_set1_ps(n.z)));
+			__m128 const position = _mm_add_ps(_mm_add_ps(_mm_add_ps(
+				_mm_mul_ps(column0, _mm_set1_ps(p.x)),
+				_mm_mul_ps(column1, _mm_set1_ps(p.y))),
+				_mm_mul_ps(column2, _mm_set1_ps(p.z))),
+				column3);
+
+			alignas(16) float out[8];
+			_mm_store_ps(out, position);
+			_mm_store_ps(out + 4, normal);
+			result.positions[v] = {out[0], out[1], out[2]};
+			result.normals[v] = {out[4], out[5], out[6]};
+		}
+	}
+
+#else
+
+	void skin_range(skinning_mesh const & mesh, glm::mat4x3 const * palette, skinned_vertices & result,
+		std::size_t begin, std::size_t end)
+	{
+		for (std::size_t v = begin; v < end; ++v)
+		{
+			auto const & joints = mesh.joints[v];
+			auto const & weights = mesh.weights[v];
+
+			glm::mat4x3 const blended = palette[joints[0]] * weights[0] + palette[joints[1]] * weights[1]
+				+ palette[joints[2]] * weights[2] + palette[joints[3]] * weights[3];
+
+			result.positions[v] = blended * glm::vec4(mesh.positions[v], 1.f);
+			result.normals[v] = glm::mat3(blended) * mesh.normals[v];
+		}
+	}
+
+#endif
+
+}
+
+void skin_mesh(skinning_mesh const & mesh, std::span<glm::mat4x3 const> palette, skinned_vertices & result, worker_pool & pool)
+{
+	assert(mesh.normals.size() == mesh.size() && mesh.joints.size() == mesh.size() && mesh.weights.size() == mesh.size());
+
+	resize(result, mesh.size());
+
+	pool.parallel_for(mesh.size(), [&](std::size_t begin, std::size_t end, std::size_t)
+	{
+		skin_range(mesh, palette.data(), result, begin, end);
+	});
+}
+
+void skin_mesh_reference(skinning_mesh const & mesh, std::span<glm::mat4x3 const> palette, skinned_vertices & result)
+{
+	resize(result, mesh.size());
+
+	for (std::size_t v = 0; v < mesh.size(); ++v)
+	{
+		auto const & joints = mesh.joints[v];
+		auto const & weights = mesh.weights[v];
+
+		glm::mat4x3 const average = palette[joints[0]] * weights[0] + palette[joints[1]] * weights[1]
+			+ palette[joints[2]] * weights[2] + palette[joints[3]] * weights[3];
+
+		result.positions[v] = glm::vec3(glm::mat4(average) * glm::vec4(mesh.positions[v], 1.f));
+		result.normals[v] = glm::mat3(average) * mesh.normals[v];
+	}
+}
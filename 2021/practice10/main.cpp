@@ -7,6 +7,8 @@
 
 #include <GL/glew.h>
 
+#include "cpu_skinning.hpp"
+
 #include <string_view>
 #include <stdexcept>
 #include <iostream>
@@ -174,8 +176,27 @@ bone_pose operator * (bone_pose const & p1, bone_pose const & p2)
 	return {p1.rotation * p2.rotation, p1.scale * p2.scale, p1.scale * glm::rotate(p1.rotation, p2.translation) + p1.translation};
 }
 
-int main() try
+bone_pose mix(bone_pose const & p1, bone_pose const & p2, float t)
+{
+	return {glm::slerp(p1.rotation, p2.rotation, t), glm::mix(p1.scale, p2.scale, t), glm::mix(p1.translation, p2.translation, t)};
+}
+
+glm::mat4x3 to_matrix(bone_pose const & pose)
 {
+	glm::mat3 const rotation = glm::mat3_cast(pose.rotation) * pose.scale;
+	return glm::mat4x3(rotation[0], rotation[1], rotation[2], pose.translation);
+}
+
+int main(int argc, char ** argv) try
+{
+	// With --cpu-skinning, the model is animated through the poses, skinned on the CPU
+	bool cpu_skinning = false;
+	for (int i = 1; i < argc; ++i)
+	{
+		if (argv[i] == std::string("--cpu-skinning"))
+			cpu_skinning = true;
+	}
+
 	if (SDL_Init(SDL_INIT_VIDEO) != 0)
 		sdl2_fail("SDL_Init: ");
 
@@ -286,6 +307,35 @@ int main() try
 
 	static_assert(sizeof(vertex) == 28);
 
+	skinning_mesh skinning;
+	skinned_vertices skinned;
+	std::vector<bone_pose> bone_poses(bones.size());
+	std::vector<glm::mat4x3> bone_matrices(bones.size());
+	worker_pool workers(cpu_skinning ? 0 : 1);
+
+	// Skinned positions followed by skinned normals, replaced every frame
+	GLuint skinned_vbo = 0;
+
+	if (cpu_skinning)
+	{
+		for (auto const & v : vertices)
+		{
+			skinning.positions.push_back(v.position);
+			skinning.normals.push_back(v.normal);
+			skinning.joints.push_back({v.bone_ids[0], v.bone_ids[1], 0, 0});
+			skinning.weights.push_back(glm::vec4(v.bone_weights[0], v.bone_weights[1], 0.f, 0.f) / 255.f);
+		}
+
+		std::size_t const stream_size = vertices.size() * sizeof(glm::vec3);
+
+		glGenBuffers(1, &skinned_vbo);
+		glBindBuffer(GL_ARRAY_BUFFER, skinned_vbo);
+		glBufferData(GL_ARRAY_BUFFER, 2 * stream_size, nullptr, GL_STREAM_DRAW);
+
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, (void*)(0));
+		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, (void*)(stream_size));
+	}
+
 	auto last_frame_start = std::chrono::high_resolution_clock::now();
 
 	float time = 0.f;
@@ -371,6 +421,31 @@ int main() try
 		glUniform3f(light_direction_location, 1.f / std::sqrt(3.f), 1.f / std::sqrt(3.f), 1.f / std::sqrt(3.f));
 		glUniform3f(light_color_location, 0.8f, 0.3f, 0.f);
 
+		if (cpu_skinning)
+		{
+			// Blend two consecutive poses, then make each bone's pose relative to the model
+			std::size_t const pose = static_cast<std::size_t>(time) % poses.size();
+			std::size_t const next_pose = (pose + 1) % poses.size();
+			float const t = time - std::floor(time);
+
+			for (std::size_t i = 0; i < bones.size(); ++i)
+			{
+				bone_poses[i] = mix(poses[pose][i], poses[next_pose][i], t);
+				if (bones[i].parent_id != -1)
+					bone_poses[i] = bone_poses[bones[i].parent_id] * bone_poses[i];
+				bone_matrices[i] = to_matrix(bone_poses[i]);
+			}
+
+			skin_mesh(skinning, bone_matrices, skinned, workers);
+
+			std::size_t const stream_size = skinned.positions.size() * sizeof(glm::vec3);
+
+			glBindBuffer(GL_ARRAY_BUFFER, skinned_vbo);
+			glBufferData(GL_ARRAY_BUFFER, 2 * stream_size, nullptr, GL_STREAM_DRAW);
+			glBufferSubData(GL_ARRAY_BUFFER, 0, stream_size, skinned.positions.data());
+			glBufferSubData(GL_ARRAY_BUFFER, stream_size, stream_size, skinned.normals.data());
+		}
+
 		glBindVertexArray(vao);
 		glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, nullptr);
 
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <type_traits>
+#include <cstddef>
+
+// A fixed set of threads for running data-parallel loops every frame, so that
+// no thread is created (and nothing is allocated) per loop. The calling thread
+// works on the loop too, so a pool of size() == 1 has no threads at all.
+struct worker_pool
+{
+	// 0 means std::thread::hardware_concurrency()
+	explicit worker_pool(std::size_t size = 0);
+	~worker_pool();
+
+	worker_pool(worker_pool const &) = delete;
+	worker_pool & operator = (worker_pool const &) = delete;
+
+	// Workers, including the calling thread
+	std::size_t size() const { return threads_.size() + 1; }
+
+	// Calls body(begin, end, worker) for chunks covering [0, count) and returns when
+	// all of them are done. `worker` is in [0, size()) and no two concurrent calls
+	// share it, so it can index per-worker scratch data. Not reentrant.
+	template <typename Body>
+	void parallel_for(std::size_t count, Body && body)
+	{
+		run(count, [](void * body, std::size_t begin, std::size_t end, std::size_t worker){
+			(*static_cast<std::remove_reference_t<Body> *>(body))(begin, end, worker);
+		}, &body);
+	}
+
+private:
+	using task = void (*)(void * body, std::size_t begin, std::size_t end, std::size_t worker);
+
+	std::vector<std::thread> threads_;
+
+	std::mutex mutex_;
+	std::condition_variable start_;
+	std::condition_variable done_;
+	std::size_t generation_ = 0;
+	std::size_t busy_ = 0;
+	bool stop_ = false;
+
+	// The current loop
+	task task_ = nullptr;
+	void * body_ = nullptr;
+	std::size_t count_ = 0;
+	std::size_t chunk_size_ = 0;
+	std::atomic<std::size_t> next_{0};
+
+	void run(std::size_t count, task task, void * body);
+	void work(std::size_t worker);
+	void thread_main(std::size_t worker);
+};
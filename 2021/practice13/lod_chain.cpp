@@ -0,0 +1,180 @@
+#include "mesh_utils.hpp"
+#include "mesh_simplifier.hpp"
+#include "mesh_error.hpp"
+#include "worker_pool.hpp"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <algorithm>
+#include <utility>
+
+// Usage: lod_chain [--ratios 0.5,0.25,...] [--border-weight W] [--threads N] [--output DIR] [file.obj ...]
+// Simplifies every input mesh into a chain of LODs with mesh_simplifier, one mesh per
+// worker, and writes LOD k of name.obj as name_lod<k>.obj into the output directory
+// (next to the input by default). Prints the triangle count and the error bounds of
+// every level. Without inputs it rebuilds the chain of bunny0.obj into the current
+// directory (unless --output is given), and also prints how far the hand-made
+// bunny1..5.obj are from bunny0.obj, for comparison.
+
+namespace
+{
+
+	std::vector<float> parse_ratios(std::string const & list)
+	{
+		std::vector<float> result;
+		std::istringstream input(list);
+		for (std::string item; std::getline(input, item, ',');)
+		{
+			float const ratio = std::stof(item);
+			if (!(ratio > 0.f && ratio <= 1.f))
+				throw std::runtime_error("Ratio out of (0, 1]: " + item);
+			result.push_back(ratio);
+		}
+		std::sort(result.begin(), result.end(), std::greater<>());
+		return result;
+	}
+
+	std::pair<std::vector<vertex>, std::vector<std::uint32_t>> load_obj_file(std::filesystem::path const & path)
+	{
+		std::ifstream input(path);
+		if (!input)
+			throw std::runtime_error("Failed to open " + path.string());
+		return load_obj(input);
+	}
+
+	std::vector<glm::vec3> positions(std::vector<vertex> const & vertices)
+	{
+		std::vector<glm::vec3> result;
+		for (auto const & v : vertices)
+			result.push_back(v.position);
+		return result;
+	}
+
+	struct job
+	{
+		explicit job(std::filesystem::path input)
+			: input(std::move(input))
+		{}
+
+		std::filesystem::path input;
+		std::size_t triangle_count = 0;
+		std::vector<lod_level> levels;
+		double time = 0.0;
+		std::string error;
+	};
+
+}
+
+int main(int argc, char ** argv) try
+{
+	simplify_options options;
+	std::size_t threads = 0;
+	std::filesystem::path output_directory;
+	std::vector<job> jobs;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		if (argv[i] == std::string("--ratios") && i + 1 < argc)
+			options.ratios = parse_ratios(argv[++i]);
+		else if (argv[i] == std::string("--border-weight") && i + 1 < argc)
+			options.border_weight = std::atof(argv[++i]);
+		else if (argv[i] == std::string("--threads") && i + 1 < argc)
+			threads = std::max(1, std::atoi(argv[++i]));
+		else if (argv[i] == std::string("--output") && i + 1 < argc)
+			output_directory = argv[++i];
+		else
+			jobs.emplace_back(argv[i]);
+	}
+
+	bool const default_input = jobs.empty();
+	if (default_input)
+	{
+		jobs.emplace_back(PRACTICE_SOURCE_DIRECTORY "/bunny0.obj");
+		// Not next to the input, which is in the source tree
+		if (output_directory.empty())
+			output_directory = std::filesystem::current_path();
+	}
+
+	worker_pool pool(threads);
+
+	// The meshes are independent: each is loaded, simplified and written by one worker
+	pool.parallel_for(jobs.size(), [&](std::size_t begin, std::size_t end, std::size_t)
+	{
+		for (std::size_t j = begin; j < end; ++j)
+		{
+			auto & job = jobs[j];
+			try
+			{
+				auto start = std::chrono::high_resolution_clock::now();
+
+				auto const [vertices, indices] = load_obj_file(job.input);
+				job.triangle_count = indices.size() / 3;
+				job.levels = build_lod_chain(vertices, indices, options);
+
+				auto const directory = output_directory.empty() ? job.input.parent_path() : output_directory;
+				for (std::size_t l = 0; l < job.levels.size(); ++l)
+				{
+					auto const path = directory / (job.input.stem().string() + "_lod" + std::to_string(l + 1) + ".obj");
+					std::ofstream output(path);
+					save_obj(output, job.levels[l].vertices, job.levels[l].indices);
+					if (!output)
+						throw std::runtime_error("Failed to write " + path.string());
+				}
+
+				auto end = std::chrono::high_resolution_clock::now();
+				job.time = std::chrono::duration_cast<std::chrono::duration<double>>(end - start).count();
+			}
+			catch (std::exception const & e)
+			{
+				job.error = e.what();
+			}
+		}
+	});
+
+	bool failed = false;
+	for (auto const & job : jobs)
+	{
+		std::cout << job.input.string() << '\n';
+		if (!job.error.empty())
+		{
+			std::cout << "    failed: " << job.error << '\n';
+			failed = true;
+			continue;
+		}
+
+		std::cout << "    triangles:            " << job.triangle_count << '\n';
+		for (std::size_t l = 0; l < job.levels.size(); ++l)
+		{
+			auto const & level = job.levels[l];
+			std::cout << "    lod " << l + 1 << ":                " << level.indices.size() / 3 << " triangles, quadric error "
+				<< level.quadric_error << ", distance " << level.distance << '\n';
+		}
+		std::cout << "    time:                 " << job.time * 1e3 << " ms\n";
+	}
+
+	if (default_input)
+	{
+		auto const [vertices, indices] = load_obj_file(jobs[0].input);
+		std::cout << "hand-made LODs\n";
+		for (int l = 1; l <= 5; ++l)
+		{
+			auto const path = PRACTICE_SOURCE_DIRECTORY "/bunny" + std::to_string(l) + ".obj";
+			auto const [lod_vertices, lod_indices] = load_obj_file(path);
+			std::cout << "    bunny" << l << ":               " << lod_indices.size() / 3 << " triangles, distance "
+				<< mesh_distance(positions(lod_vertices), lod_indices, positions(vertices), indices) << '\n';
+		}
+	}
+
+	return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+catch (std::exception const & e)
+{
+	std::cerr << e.what() << std::endl;
+	return EXIT_FAILURE;
+}
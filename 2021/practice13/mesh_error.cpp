@@ -0,0 +1,198 @@
+#include "mesh_error.hpp"
+
+#include <glm/geometric.hpp>
+#include <glm/common.hpp>
+
+#include <algorithm>
+#include <limits>
+#include <cmath>
+
+namespace
+{
+
+	// Ericson, Real-Time Collision Detection, 5.1.5
+	glm::vec3 closest_point_on_triangle(glm::vec3 const & p, glm::vec3 const & a, glm::vec3 const & b, glm::vec3 const & c)
+	{
+		glm::vec3 const ab = b - a;
+		glm::vec3 const ac = c - a;
+		glm::vec3 const ap = p - a;
+
+		float const d1 = glm::dot(ab, ap);
+		float const d2 = glm::dot(ac, ap);
+		if (d1 <= 0.f && d2 <= 0.f) return a;
+
+		glm::vec3 const bp = p - b;
+		float const d3 = glm::dot(ab, bp);
+		float const d4 = glm::dot(ac, bp);
+		if (d3 >= 0.f && d4 <= d3) return b;
+
+		float const vc = d1 * d4 - d3 * d2;
+		if (vc <= 0.f && d1 >= 0.f && d3 <= 0.f)
+			return a + ab * (d1 / (d1 - d3));
+
+		glm::vec3 const cp = p - c;
+		float const d5 = glm::dot(ab, cp);
+		float const d6 = glm::dot(ac, cp);
+		if (d6 >= 0.f && d5 <= d6) return c;
+
+		float const vb = d5 * d2 - d1 * d6;
+		if (vb <= 0.f && d2 >= 0.f && d6 <= 0.f)
+			return a + ac * (d2 / (d2 - d6));
+
+		float const va = d3 * d6 - d5 * d4;
+		if (va <= 0.f && (d4 - d3) >= 0.f && (d5 - d6) >= 0.f)
+			return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+
+		float const denominator = 1.f / (va + vb + vc);
+		return a + ab * (vb * denominator) + ac * (vc * denominator);
+	}
+
+	// Triangles bucketed into a uniform grid over their bounds, for nearest-triangle queries
+	struct triangle_grid
+	{
+		std::span<glm::vec3 const> positions;
+		std::span<std::uint32_t const> indices;
+
+		glm::vec3 min;
+		float cell_size;
+		glm::ivec3 resolution;
+		// The triangles of cell c are triangles[cell_start[c], cell_start[c + 1])
+		std::vector<std::uint32_t> cell_start;
+		std::vector<std::uint32_t> triangles;
+
+		triangle_grid(std::span<glm::vec3 const> positions, std::span<std::uint32_t const> indices)
+			: positions(positions)
+			, indices(indices)
+		{
+			glm::vec3 max(-std::numeric_limits<float>::infinity());
+			min = glm::vec3(std::numeric_limits<float>::infinity());
+			for (auto index : indices)
+			{
+				min = glm::min(min, positions[index]);
+				max = glm::max(max, positions[index]);
+			}
+
+			// About one triangle per cell
+			std::size_t const triangle_count = indices.size() / 3;
+			glm::vec3 const size = glm::max(max - min, glm::vec3(1e-6f));
+			cell_size = std::cbrt(size.x * size.y * size.z / std::max<std::size_t>(triangle_count, 1));
+			cell_size = std::max(cell_size, std::max({size.x, size.y, size.z}) / 64.f);
+			resolution = glm::max(glm::ivec3(glm::ceil(size / cell_size)), glm::ivec3(1));
+
+			std::vector<std::uint32_t> counts(cell_count() + 1, 0);
+			for_each_cell_of_triangles([&](std::size_t cell, std::uint32_t){ ++counts[cell + 1]; });
+			for (std::size_t c = 1; c < counts.size(); ++c)
+				counts[c] += counts[c - 1];
+
+			cell_start = counts;
+			triangles.resize(counts.back());
+			for_each_cell_of_triangles([&](std::size_t cell, std::uint32_t t){ triangles[counts[cell]++] = t; });
+		}
+
+		std::size_t cell_count() const { return std::size_t(resolution.x) * resolution.y * resolution.z; }
+
+		std::size_t cell_index(glm::ivec3 const & c) const
+		{
+			return (std::size_t(c.z) * resolution.y + c.y) * resolution.x + c.x;
+		}
+
+		glm::ivec3 cell_of(glm::vec3 const & p) const
+		{
+			return glm::clamp(glm::ivec3(glm::floor((p - min) / cell_size)), glm::ivec3(0), resolution - 1);
+		}
+
+		template <typename F>
+		void for_each_cell_of_triangles(F && f) const
+		{
+			for (std::uint32_t t = 0; t < indices.size() / 3; ++t)
+			{
+				glm::vec3 const & a = positions[indices[3 * t + 0]];
+				glm::vec3 const & b = positions[indices[3 * t + 1]];
+				glm::vec3 const & c = positions[indices[3 * t + 2]];
+
+				glm::ivec3 const lo = cell_of(glm::min(a, glm::min(b, c)));
+				glm::ivec3 const hi = cell_of(glm::max(a, glm::max(b, c)));
+				for (int z = lo.z; z <= hi.z; ++z)
+					for (int y = lo.y; y <= hi.y; ++y)
+						for (int x = lo.x; x <= hi.x; ++x)
+							f(cell_index({x, y, z}), t);
+			}
+		}
+
+		float squared_distance_to_triangle(glm::vec3 const & p, std::uint32_t t) const
+		{
+			glm::vec3 const q = closest_point_on_triangle(p,
+				positions[indices[3 * t + 0]], positions[indices[3 * t + 1]], positions[indices[3 * t + 2]]);
+			return glm::dot(p - q, p - q);
+		}
+
+		// Searches cubic shells of cells around the point's cell until nothing
+		// outside the searched cells can be closer than the best triangle found
+		float distance(glm::vec3 const & p) const
+		{
+			glm::ivec3 const center = cell_of(p);
+
+			// A point outside the grid is farther from the unsearched cells than the shells
+			// suggest, but not by the distance to the grid bounds added on: that distance and
+			// the shells' reach may run along different axes, so they combine as legs of a
+			// right triangle
+			glm::vec3 const max = min + glm::vec3(resolution) * cell_size;
+			float const outside = glm::length(glm::max(glm::max(min - p, p - max), glm::vec3(0.f)));
+			// and a point inside is at least this far from the walls of its cell
+			glm::vec3 const cell_min = min + glm::vec3(center) * cell_size;
+			glm::vec3 const walls = glm::min(p - cell_min, cell_min + cell_size - p);
+			float const inside = std::max(0.f, std::min({walls.x, walls.y, walls.z}));
+
+			float best = std::numeric_limits<float>::infinity();
+			int const max_radius = std::max({resolution.x, resolution.y, resolution.z});
+
+			for (int r = 0; r <= max_radius; ++r)
+			{
+				glm::ivec3 const lo = glm::max(center - r, glm::ivec3(0));
+				glm::ivec3 const hi = glm::min(center + r, resolution - 1);
+
+				for (int z = lo.z; z <= hi.z; ++z)
+					for (int y = lo.y; y <= hi.y; ++y)
+						for (int x = lo.x; x <= hi.x; ++x)
+						{
+							// Only the shell; the inside was searched before
+							if (std::max({std::abs(x - center.x), std::abs(y - center.y), std::abs(z - center.z)}) != r)
+								continue;
+
+							std::size_t const cell = cell_index({x, y, z});
+							for (std::uint32_t k = cell_start[cell]; k < cell_start[cell + 1]; ++k)
+								best = std::min(best, squared_distance_to_triangle(p, triangles[k]));
+						}
+
+				float const reach = inside + r * cell_size;
+				if (best <= outside * outside + reach * reach)
+					break;
+			}
+
+			return std::sqrt(best);
+		}
+	};
+
+}
+
+float max_distance_to_mesh(std::span<glm::vec3 const> points,
+	std::span<glm::vec3 const> positions, std::span<std::uint32_t const> indices)
+{
+	if (points.empty() || indices.size() < 3)
+		return 0.f;
+
+	triangle_grid const grid(positions, indices);
+
+	float result = 0.f;
+	for (auto const & p : points)
+		result = std::max(result, grid.distance(p));
+	return result;
+}
+
+float mesh_distance(std::span<glm::vec3 const> positions_a, std::span<std::uint32_t const> indices_a,
+	std::span<glm::vec3 const> positions_b, std::span<std::uint32_t const> indices_b)
+{
+	return std::max(
+		max_distance_to_mesh(positions_a, positions_b, indices_b),
+		max_distance_to_mesh(positions_b, positions_a, indices_a));
+}
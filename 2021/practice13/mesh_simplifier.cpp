@@ -0,0 +1,403 @@
+#include "mesh_simplifier.hpp"
+#include "mesh_error.hpp"
+
+#include <glm/vec3.hpp>
+#include <glm/geometric.hpp>
+
+#include <array>
+#include <iterator>
+#include <queue>
+#include <algorithm>
+#include <stdexcept>
+#include <cmath>
+
+namespace
+{
+
+	// The symmetric 4x4 matrix of a sum of squared plane distances, upper triangle only
+	struct quadric
+	{
+		double xx = 0.0, xy = 0.0, xz = 0.0, xw = 0.0;
+		double yy = 0.0, yz = 0.0, yw = 0.0;
+		double zz = 0.0, zw = 0.0;
+		double ww = 0.0;
+
+		// The squared distance to the plane dot(n, p) + d = 0, times `weight`; n is unit length
+		static quadric plane(glm::dvec3 const & n, double d, double weight)
+		{
+			quadric q;
+			q.xx = weight * n.x * n.x; q.xy = weight * n.x * n.y; q.xz = weight * n.x * n.z; q.xw = weight * n.x * d;
+			q.yy = weight * n.y * n.y; q.yz = weight * n.y * n.z; q.yw = weight * n.y * d;
+			q.zz = weight * n.z * n.z; q.zw = weight * n.z * d;
+			q.ww = weight * d * d;
+			return q;
+		}
+
+		quadric & operator += (quadric const & q)
+		{
+			xx += q.xx; xy += q.xy; xz += q.xz; xw += q.xw;
+			yy += q.yy; yz += q.yz; yw += q.yw;
+			zz += q.zz; zw += q.zw;
+			ww += q.ww;
+			return *this;
+		}
+
+		friend quadric operator + (quadric a, quadric const & b)
+		{
+			return a += b;
+		}
+
+		double error(glm::dvec3 const & p) const
+		{
+			return p.x * (xx * p.x + 2.0 * (xy * p.y + xz * p.z + xw))
+				+ p.y * (yy * p.y + 2.0 * (yz * p.z + yw))
+				+ p.z * (zz * p.z + 2.0 * zw)
+				+ ww;
+		}
+
+		// The point of least error, unless the planes don't pin one down
+		// (they are all nearly parallel, or there are fewer than three directions)
+		bool minimum(glm::dvec3 & result) const
+		{
+			double const c00 = yy * zz - yz * yz;
+			double const c01 = xz * yz - xy * zz;
+			double const c02 = xy * yz - xz * yy;
+			double const det = xx * c00 + xy * c01 + xz * c02;
+
+			double const scale = xx + yy + zz;
+			if (std::abs(det) <= 1e-9 * scale * scale * scale)
+				return false;
+
+			double const c11 = xx * zz - xz * xz;
+			double const c12 = xy * xz - xx * yz;
+			double const c22 = xx * yy - xy * xy;
+
+			// Solve A x = -b with the adjugate of A
+			result = -glm::dvec3(
+				c00 * xw + c01 * yw + c02 * zw,
+				c01 * xw + c11 * yw + c12 * zw,
+				c02 * xw + c12 * yw + c22 * zw) / det;
+			return true;
+		}
+	};
+
+	struct collapse
+	{
+		double cost;
+		// b is merged into a
+		std::uint32_t a, b;
+		// The versions of a and b when this was computed; stale entries are skipped
+		std::uint32_t version_a, version_b;
+		glm::vec3 position;
+
+		// The cheapest first out of a std::priority_queue
+		friend bool operator < (collapse const & x, collapse const & y)
+		{
+			return x.cost > y.cost;
+		}
+	};
+
+	using triangle = std::array<std::uint32_t, 3>;
+
+	bool contains(triangle const & t, std::uint32_t v)
+	{
+		return t[0] == v || t[1] == v || t[2] == v;
+	}
+
+	struct simplifier
+	{
+		std::vector<glm::vec3> positions;
+		std::vector<quadric> quadrics;
+		std::vector<std::uint32_t> versions;
+		std::vector<bool> removed_vertices;
+
+		std::vector<triangle> triangles;
+		std::vector<bool> removed_triangles;
+		std::size_t triangle_count;
+
+		// Live and removed triangles of every vertex; removed ones are dropped on the next collapse touching it
+		std::vector<std::vector<std::uint32_t>> vertex_triangles;
+
+		std::priority_queue<collapse> queue;
+		double max_cost = 0.0;
+
+		simplifier(std::vector<vertex> const & vertices, std::vector<std::uint32_t> const & indices, float border_weight)
+			: positions(vertices.size())
+			, quadrics(vertices.size())
+			, versions(vertices.size(), 0)
+			, removed_vertices(vertices.size(), false)
+			, triangles(indices.size() / 3)
+			, removed_triangles(indices.size() / 3, false)
+			, triangle_count(indices.size() / 3)
+			, vertex_triangles(vertices.size())
+		{
+			for (std::size_t v = 0; v < vertices.size(); ++v)
+				positions[v] = vertices[v].position;
+
+			for (std::uint32_t t = 0; t < triangles.size(); ++t)
+			{
+				triangles[t] = {indices[3 * t + 0], indices[3 * t + 1], indices[3 * t + 2]};
+				for (auto v : triangles[t])
+				{
+					if (v >= vertices.size())
+						throw std::runtime_error("Index out of range: " + std::to_string(v));
+					vertex_triangles[v].push_back(t);
+				}
+
+				glm::dvec3 const p0 = positions[triangles[t][0]];
+				glm::dvec3 const n = glm::cross(glm::dvec3(positions[triangles[t][1]]) - p0, glm::dvec3(positions[triangles[t][2]]) - p0);
+				if (glm::dot(n, n) == 0.0)
+					continue;
+
+				glm::dvec3 const unit = glm::normalize(n);
+				auto const q = quadric::plane(unit, -glm::dot(unit, p0), 1.0);
+				for (auto v : triangles[t])
+					quadrics[v] += q;
+			}
+
+			// Every edge once, as (min, max), with the number of triangles sharing it
+			std::vector<std::pair<std::uint32_t, std::uint32_t>> edges;
+			for (auto const & t : triangles)
+				for (int i = 0; i < 3; ++i)
+					edges.emplace_back(std::min(t[i], t[(i + 1) % 3]), std::max(t[i], t[(i + 1) % 3]));
+			std::sort(edges.begin(), edges.end());
+
+			for (std::size_t begin = 0; begin < edges.size();)
+			{
+				std::size_t end = begin + 1;
+				while (end < edges.size() && edges[end] == edges[begin])
+					++end;
+
+				auto const [a, b] = edges[begin];
+				if (end - begin == 1)
+					add_border_plane(a, b, border_weight);
+				begin = end;
+			}
+
+			edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+			for (auto const & [a, b] : edges)
+				push(a, b);
+		}
+
+		// A plane through a border edge, perpendicular to its triangle, so that
+		// moving the border's vertices off the border costs like moving them off a surface
+		void add_border_plane(std::uint32_t a, std::uint32_t b, float weight)
+		{
+			for (auto t : vertex_triangles[a])
+			{
+				if (!contains(triangles[t], b))
+					continue;
+
+				glm::dvec3 const p0 = positions[triangles[t][0]];
+				glm::dvec3 const n = glm::cross(glm::dvec3(positions[triangles[t][1]]) - p0, glm::dvec3(positions[triangles[t][2]]) - p0);
+				glm::dvec3 const border = glm::cross(glm::dvec3(positions[b]) - glm::dvec3(positions[a]), n);
+				if (glm::dot(border, border) == 0.0)
+					return;
+
+				glm::dvec3 const unit = glm::normalize(border);
+				auto const q = quadric::plane(unit, -glm::dot(unit, glm::dvec3(positions[a])), weight);
+				quadrics[a] += q;
+				quadrics[b] += q;
+				return;
+			}
+		}
+
+		void push(std::uint32_t a, std::uint32_t b)
+		{
+			auto const q = quadrics[a] + quadrics[b];
+
+			glm::dvec3 position;
+			double cost;
+			if (q.minimum(position))
+				cost = q.error(position);
+			else
+			{
+				// The best of the endpoints and the midpoint
+				glm::dvec3 const pa = positions[a];
+				glm::dvec3 const pb = positions[b];
+				position = pa;
+				cost = q.error(pa);
+				for (auto const & candidate : {pb, (pa + pb) * 0.5})
+				{
+					if (double const c = q.error(candidate); c < cost)
+					{
+						position = candidate;
+						cost = c;
+					}
+				}
+			}
+
+			queue.push({std::max(cost, 0.0), a, b, versions[a], versions[b], glm::vec3(position)});
+		}
+
+		void drop_removed_triangles(std::uint32_t v)
+		{
+			auto & list = vertex_triangles[v];
+			list.erase(std::remove_if(list.begin(), list.end(), [&](std::uint32_t t){ return removed_triangles[t]; }), list.end());
+		}
+
+		void neighbours(std::uint32_t v, std::vector<std::uint32_t> & result) const
+		{
+			result.clear();
+			for (auto t : vertex_triangles[v])
+				for (auto u : triangles[t])
+					if (u != v)
+						result.push_back(u);
+			std::sort(result.begin(), result.end());
+			result.erase(std::unique(result.begin(), result.end()), result.end());
+		}
+
+		// Whether moving v to `position` turns any of its triangles not shared with `other` over
+		bool flips(std::uint32_t v, std::uint32_t other, glm::vec3 const & position) const
+		{
+			for (auto t : vertex_triangles[v])
+			{
+				auto const & corners = triangles[t];
+				if (contains(corners, other))
+					continue;
+
+				glm::vec3 before[3], after[3];
+				for (int i = 0; i < 3; ++i)
+				{
+					before[i] = positions[corners[i]];
+					after[i] = (corners[i] == v) ? position : before[i];
+				}
+
+				glm::vec3 const n_before = glm::cross(before[1] - before[0], before[2] - before[0]);
+				glm::vec3 const n_after = glm::cross(after[1] - after[0], after[2] - after[0]);
+				if (glm::dot(n_before, n_after) <= 0.f)
+					return true;
+			}
+			return false;
+		}
+
+		std::vector<std::uint32_t> neighbours_a, neighbours_b, common;
+
+		bool try_collapse(collapse const & c)
+		{
+			auto const a = c.a;
+			auto const b = c.b;
+			if (removed_vertices[a] || removed_vertices[b] || versions[a] != c.version_a || versions[b] != c.version_b)
+				return false;
+
+			drop_removed_triangles(a);
+			drop_removed_triangles(b);
+
+			std::size_t shared = 0;
+			for (auto t : vertex_triangles[a])
+				shared += contains(triangles[t], b);
+			if (shared == 0)
+				return false;
+
+			// The link condition: a and b may only have the neighbours of their shared triangles
+			// in common, or the collapse pinches the surface
+			neighbours(a, neighbours_a);
+			neighbours(b, neighbours_b);
+			common.clear();
+			std::set_intersection(neighbours_a.begin(), neighbours_a.end(), neighbours_b.begin(), neighbours_b.end(), std::back_inserter(common));
+			if (common.size() != shared)
+				return false;
+
+			if (flips(a, b, c.position) || flips(b, a, c.position))
+				return false;
+
+			for (auto t : vertex_triangles[b])
+			{
+				auto & corners = triangles[t];
+				if (contains(corners, a))
+				{
+					removed_triangles[t] = true;
+					--triangle_count;
+					continue;
+				}
+
+				std::replace(corners.begin(), corners.end(), b, a);
+				vertex_triangles[a].push_back(t);
+			}
+			vertex_triangles[b].clear();
+			drop_removed_triangles(a);
+
+			positions[a] = c.position;
+			quadrics[a] += quadrics[b];
+			removed_vertices[b] = true;
+			++versions[a];
+			++versions[b];
+			max_cost = std::max(max_cost, c.cost);
+
+			neighbours(a, neighbours_a);
+			for (auto u : neighbours_a)
+				push(a, u);
+
+			return true;
+		}
+
+		void simplify(std::size_t target)
+		{
+			while (triangle_count > target && !queue.empty())
+			{
+				auto const c = queue.top();
+				queue.pop();
+				try_collapse(c);
+			}
+		}
+
+		lod_level snapshot() const
+		{
+			lod_level result;
+
+			std::vector<std::uint32_t> remap(positions.size(), std::uint32_t(-1));
+			result.indices.reserve(3 * triangle_count);
+			for (std::size_t t = 0; t < triangles.size(); ++t)
+			{
+				if (removed_triangles[t])
+					continue;
+
+				for (auto v : triangles[t])
+				{
+					if (remap[v] == std::uint32_t(-1))
+					{
+						remap[v] = result.vertices.size();
+						result.vertices.push_back({positions[v], glm::vec3(0.f)});
+					}
+					result.indices.push_back(remap[v]);
+				}
+			}
+
+			fill_normals(result.vertices, result.indices);
+			result.quadric_error = std::sqrt(max_cost);
+			result.distance = 0.f;
+			return result;
+		}
+	};
+
+	std::vector<glm::vec3> vertex_positions(std::vector<vertex> const & vertices)
+	{
+		std::vector<glm::vec3> result(vertices.size());
+		for (std::size_t v = 0; v < vertices.size(); ++v)
+			result[v] = vertices[v].position;
+		return result;
+	}
+
+}
+
+std::vector<lod_level> build_lod_chain(std::vector<vertex> const & vertices, std::vector<std::uint32_t> const & indices,
+	simplify_options const & options)
+{
+	if (indices.size() % 3 != 0)
+		throw std::runtime_error("Index count is not a multiple of 3: " + std::to_string(indices.size()));
+
+	simplifier s(vertices, indices, options.border_weight);
+
+	auto const original_positions = vertex_positions(vertices);
+	std::size_t const triangle_count = indices.size() / 3;
+
+	std::vector<lod_level> result;
+	for (float ratio : options.ratios)
+	{
+		s.simplify(std::max<std::size_t>(1, std::size_t(std::ceil(ratio * triangle_count))));
+
+		auto & level = result.emplace_back(s.snapshot());
+		level.distance = mesh_distance(vertex_positions(level.vertices), level.indices, original_positions, indices);
+	}
+	return result;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "mesh_utils.hpp"
+
+#include <vector>
+#include <cstdint>
+
+// Quadric error metric simplification (Garland & Heckbert, 1997): every vertex
+// carries the sum of the squared distances to the planes of its triangles, and
+// the edge whose collapse adds the least to it is collapsed first, into the point
+// that minimizes the merged quadric. Collapses that would flip a triangle or make
+// the mesh non-manifold are skipped, and open borders are held in place by extra
+// planes perpendicular to them. Offline: this allocates freely and takes tens of
+// milliseconds for a few thousand triangles.
+
+struct simplify_options
+{
+	// Target triangle counts of the levels, as fractions of the input's, in decreasing order
+	std::vector<float> ratios{0.5f, 0.25f, 0.125f, 0.0625f, 0.03125f};
+	// How much more a border plane weighs than a triangle plane
+	float border_weight = 10.f;
+};
+
+struct lod_level
+{
+	// Compacted, with normals recomputed by fill_normals
+	std::vector<vertex> vertices;
+	std::vector<std::uint32_t> indices;
+
+	// An upper bound on the distance from any vertex of the level to the planes of
+	// the original triangles that were merged into it: the square root of the
+	// largest quadric error of all collapses so far
+	float quadric_error;
+	// The measured error: the largest distance from a vertex of either mesh to the
+	// surface of the other (mesh_distance), in the units of the input
+	float distance;
+};
+
+// Each level is simplified further from the previous one, so the chain can be
+// streamed or blended. A level ends up with more triangles than its target when
+// no more edges can be collapsed.
+std::vector<lod_level> build_lod_chain(std::vector<vertex> const & vertices, std::vector<std::uint32_t> const & indices,
+	simplify_options const & options = {});
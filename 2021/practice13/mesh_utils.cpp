@@ -55,6 +55,15 @@ std::pair<std::vector<vertex>, std::vector<std::uint32_t>> load_obj(std::istream
 	return {vertices, indices};
 }
 
+void save_obj(std::ostream & output, std::vector<vertex> const & vertices, std::vector<std::uint32_t> const & indices)
+{
+	for (auto const & v : vertices)
+		output << "v " << v.position.x << ' ' << v.position.y << ' ' << v.position.z << '\n';
+
+	for (std::size_t i = 0; i < indices.size(); i += 3)
+		output << "f " << indices[i + 0] + 1 << ' ' << indices[i + 1] + 1 << ' ' << indices[i + 2] + 1 << '\n';
+}
+
 std::pair<glm::vec3, glm::vec3> bbox(std::vector<vertex> const & vertices)
 {
 	static const float inf = std::numeric_limits<float>::infinity();
@@ -14,6 +14,9 @@ struct vertex
 
 std::pair<std::vector<vertex>, std::vector<std::uint32_t>> load_obj(std::istream & input, float scale = 1.f);
 
+// Positions and triangles only, as load_obj reads them
+void save_obj(std::ostream & output, std::vector<vertex> const & vertices, std::vector<std::uint32_t> const & indices);
+
 std::pair<glm::vec3, glm::vec3> bbox(std::vector<vertex> const & vertices);
 
 void fill_normals(std::vector<vertex> & vertices, std::vector<std::uint32_t> const & indices);
@@ -0,0 +1,66 @@
+#include "draw_list.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <tuple>
+
+draw_list build_draw_list(scene_geometry const & geometry, std::vector<tinyobj::shape_t> const & shapes,
+    std::vector<tinyobj::material_t> const & materials)
+{
+    struct shape_key
+    {
+        bool blend;
+        int material_id;
+        std::size_t first;
+        std::size_t count;
+    };
+
+    std::vector<shape_key> keys;
+    keys.reserve(shapes.size());
+
+    for (std::size_t shape_id = 0; shape_id < shapes.size(); ++shape_id)
+    {
+        auto const & range = geometry.shape_ranges[shape_id];
+        if (range.count == 0)
+            continue;
+
+        int const material_id = shapes[shape_id].mesh.material_ids.empty() ? -1 : shapes[shape_id].mesh.material_ids[0];
+        bool const blend = material_id >= 0 && materials[material_id].dissolve < blend_dissolve_threshold;
+
+        keys.push_back({blend, material_id, range.first, range.count});
+    }
+
+    std::sort(keys.begin(), keys.end(), [](shape_key const & a, shape_key const & b){
+        return std::tie(a.blend, a.material_id, a.first) < std::tie(b.blend, b.material_id, b.first);
+    });
+
+    draw_list result;
+
+    // End of the last range of the current batch, in indices
+    std::size_t batch_end = 0;
+
+    for (auto const & key : keys)
+    {
+        if (result.batches.empty() || result.batches.back().blend != key.blend || result.batches.back().material_id != key.material_id)
+        {
+            draw_batch batch;
+            batch.material_id = key.material_id;
+            batch.blend = key.blend;
+            result.batches.push_back(std::move(batch));
+        }
+
+        auto & batch = result.batches.back();
+
+        if (!batch.counts.empty() && batch_end == key.first)
+            batch.counts.back() += key.count;
+        else
+        {
+            batch.counts.push_back(key.count);
+            batch.offsets.push_back(reinterpret_cast<void const *>(key.first * sizeof(std::uint32_t)));
+        }
+
+        batch_end = key.first + key.count;
+    }
+
+    return result;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "scene_geometry.hpp"
+
+#include <GL/glew.h>
+
+#include <vector>
+
+// The shapes of a scene grouped by the render state they need, so that every
+// group is a single glMultiDrawElements call from the shared index buffer.
+// Opaque groups come first and blended ones last, each ordered by material.
+
+struct draw_batch
+{
+    // -1 for shapes without a material
+    int material_id;
+    bool blend;
+
+    // Arguments of glMultiDrawElements; ranges that follow each other in the
+    // index buffer are merged into one
+    std::vector<GLsizei> counts;
+    std::vector<void const *> offsets;
+};
+
+struct draw_list
+{
+    std::vector<draw_batch> batches;
+};
+
+// Materials with dissolve below this are drawn with alpha blending
+constexpr float blend_dissolve_threshold = 0.95f;
+
+draw_list build_draw_list(scene_geometry const & geometry, std::vector<tinyobj::shape_t> const & shapes,
+    std::vector<tinyobj::material_t> const & materials);
+
+// Per-frame counters, reset by the render loop at the start of every frame
+struct draw_stats
+{
+    std::size_t draw_calls = 0;
+    // Texture binds, material uniform updates and blend toggles
+    std::size_t state_changes = 0;
+};
@@ -33,10 +33,10 @@
 
 #include "stb_image.h"
 
-#define TINYOBJLOADER_IMPLEMENTATION
-#include "tiny_obj_loader.h"
-
 #include "shaders.h"
+#include "scene_geometry.hpp"
+#include "obj_buffers.hpp"
+#include "draw_list.hpp"
 
 std::string to_string(std::string_view str)
 {
@@ -276,70 +276,23 @@ int main() try
         has_texture[material_id] = true;
     }
 
-    GLuint vao, vbo, nbo, tbo;
+    GLuint vao;
     glGenVertexArrays(1, &vao);
     glBindVertexArray(vao);
 
+    scene_geometry_stats geometry_stats;
+    scene_geometry geometry = build_scene_geometry(attrib, shapes, &geometry_stats);
 
+    std::cout << "vertices: " << geometry_stats.corners << " corners -> " << geometry_stats.unique_vertices << " unique, "
+        << geometry.material_ranges.size() << " material ranges" << std::endl;
+    std::cout << "GPU memory: " << geometry_stats.unindexed_bytes / double(1 << 20) << " MB -> "
+        << geometry_stats.indexed_bytes / double(1 << 20) << " MB (saved "
+        << (double(geometry_stats.unindexed_bytes) - double(geometry_stats.indexed_bytes)) / double(1 << 20) << " MB)" << std::endl;
 
-    std::vector<GLuint> ebos(shapes.size());
-    glGenBuffers(shapes.size(), ebos.data());
-
-    std::vector<float> vertex_vec, normal_vec, texcoord_vec;
-
-    int offset = 0;
-
-    std::vector<uint> indices_all;
-
-    for(int shape_id = 0; shape_id < shapes.size(); shape_id++) {
-        int i = 0;
-        std::vector<uint> indices;
-        for (auto index : shapes[shape_id].mesh.indices) {
-            vertex_vec.push_back(attrib.vertices[index.vertex_index * 3]);
-            vertex_vec.push_back(attrib.vertices[index.vertex_index * 3 + 1]);
-            vertex_vec.push_back(attrib.vertices[index.vertex_index * 3 + 2]);
-            normal_vec.push_back(attrib.normals[index.normal_index * 3]);
-            normal_vec.push_back(attrib.normals[index.normal_index * 3 + 1]);
-            normal_vec.push_back(attrib.normals[index.normal_index * 3 + 2]);
-            texcoord_vec.push_back(attrib.texcoords[index.texcoord_index * 2]);
-            texcoord_vec.push_back(attrib.texcoords[index.texcoord_index * 2 + 1]);
-            indices.push_back(offset + i);
-            indices_all.push_back(offset + i);
-            i++;
-        }
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebos[shape_id]);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(indices[0]), indices.data(), GL_STATIC_DRAW);
-        offset += i;
-    }
-
-    GLuint ebo_all;
-    glGenBuffers(1, &ebo_all);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo_all);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices_all.size() * sizeof(indices_all[0]), indices_all.data(), GL_STATIC_DRAW);
-
-    int vertex_count = offset;
-
-    glGenBuffers(1, &vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    glBufferData(GL_ARRAY_BUFFER, vertex_count * sizeof(attrib.vertices[0]) * 3, vertex_vec.data(), GL_STATIC_DRAW);
-    glGenBuffers(1, &nbo);
-    glBindBuffer(GL_ARRAY_BUFFER, nbo);
-    glBufferData(GL_ARRAY_BUFFER, vertex_count * sizeof(attrib.normals[0]) * 3, normal_vec.data(), GL_STATIC_DRAW);
-    glGenBuffers(1, &tbo);
-    glBindBuffer(GL_ARRAY_BUFFER, tbo);
-    glBufferData(GL_ARRAY_BUFFER, vertex_count * sizeof(attrib.texcoords[0]) * 2, texcoord_vec.data(), GL_STATIC_DRAW);
-
+    obj_buffers scene_buffers = create_obj_buffers(geometry.mesh);
 
-
-    glEnableVertexAttribArray(0);
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(attrib.vertices[0]) * 3, (void*)(0));
-    glEnableVertexAttribArray(1);
-    glBindBuffer(GL_ARRAY_BUFFER, nbo);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(attrib.normals[0]) * 3, (void*)(0));
-    glEnableVertexAttribArray(2);
-    glBindBuffer(GL_ARRAY_BUFFER, tbo);
-    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(attrib.texcoords[0]) * 2, (void*)(0));
+    draw_list scene_draw_list = build_draw_list(geometry, shapes, materials);
+    std::cout << "draw list: " << shapes.size() << " shapes -> " << scene_draw_list.batches.size() << " batches" << std::endl;
 
     GLuint debug_vao;
     glGenVertexArrays(1, &debug_vao);
@@ -428,6 +381,11 @@ int main() try
     float time = 0.f;
     bool paused = false;
 
+    draw_stats frame_stats;
+    draw_stats report_stats;
+    int report_frames = 0;
+    float report_time = 0.f;
+
     std::map<SDL_Keycode, bool> button_down;
 
 
@@ -508,6 +466,21 @@ int main() try
         if (!paused)
             time += dt;
 
+        // Average draw counters over about a second
+        report_stats.draw_calls += frame_stats.draw_calls;
+        report_stats.state_changes += frame_stats.state_changes;
+        ++report_frames;
+        report_time += dt;
+        if (report_time >= 1.f)
+        {
+            std::cout << "per frame: " << report_stats.draw_calls / report_frames << " draw calls, "
+                << report_stats.state_changes / report_frames << " state changes" << std::endl;
+            report_stats = draw_stats{};
+            report_frames = 0;
+            report_time = 0.f;
+        }
+        frame_stats = draw_stats{};
+
 
         if (button_down[SDLK_UP])
             camera_rotation[0] -= dt;
@@ -595,8 +568,9 @@ int main() try
         glUniformMatrix4fv(shadow_transform_location, 1, GL_FALSE, reinterpret_cast<float *>(&transform));
 
         glBindVertexArray(vao);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo_all);
-        glDrawElements(GL_TRIANGLES, indices_all.size(), GL_UNSIGNED_INT, nullptr);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, scene_buffers.ebo);
+        glDrawElements(GL_TRIANGLES, geometry.mesh.indices.size(), GL_UNSIGNED_INT, nullptr);
+        ++frame_stats.draw_calls;
 
         glBindTexture(GL_TEXTURE_2D, shadow_map);
         glGenerateMipmap(GL_TEXTURE_2D);
@@ -649,8 +623,9 @@ int main() try
                 glUniformMatrix4fv(shadow_transform_location, 1, GL_FALSE, reinterpret_cast<float *>(&lamp_transform));
 
                 glBindVertexArray(vao);
-                glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo_all);
-                glDrawElements(GL_TRIANGLES, indices_all.size(), GL_UNSIGNED_INT, nullptr);
+                glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, scene_buffers.ebo);
+                glDrawElements(GL_TRIANGLES, geometry.mesh.indices.size(), GL_UNSIGNED_INT, nullptr);
+                ++frame_stats.draw_calls;
 
 //                glViewport(0, 0, width, height);
 
@@ -726,45 +701,59 @@ int main() try
 
 
         glBindVertexArray(vao);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, scene_buffers.ebo);
 
-        for(int shape_id = 0; shape_id < shapes.size(); shape_id++) {
-
-            int material_id = shapes[shape_id].mesh.material_ids[0];
+        glActiveTexture(GL_TEXTURE1);
+        glUniform1i(texture_map_location, 1);
+        glUniform1i(shadow_cube_map_location, 2);
 
-            glActiveTexture(GL_TEXTURE1);
-            glBindTexture(GL_TEXTURE_2D, textures[material_id]);
+        bool blend = false;
 
-            glUniform1f(alpha_location, materials[material_id].dissolve);
+        for (auto const & batch : scene_draw_list.batches) {
 
-            glUniform3fv(glossiness_location, 1, materials[material_id].specular);
-            glUniform1f(power_location, materials[material_id].shininess);
+            int material_id = batch.material_id;
 
-            if (materials[material_id].dissolve < 0.95) {
-                glEnable(GL_BLEND);
-                glBlendEquation(GL_FUNC_ADD);
-                glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+            if (batch.blend != blend) {
+                if (batch.blend) {
+                    glEnable(GL_BLEND);
+                    glBlendEquation(GL_FUNC_ADD);
+                    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+                } else {
+                    glDisable(GL_BLEND);
+                }
+                blend = batch.blend;
+                ++frame_stats.state_changes;
             }
 
-//            std::cout << materials[material_id].dissolve << std::endl;
+            if (material_id >= 0) {
+                glBindTexture(GL_TEXTURE_2D, has_texture[material_id] ? textures[material_id] : rl_texture);
 
+                glUniform1f(alpha_location, materials[material_id].dissolve);
 
-            if (!has_texture[material_id])
+                glUniform3fv(glossiness_location, 1, materials[material_id].specular);
+                glUniform1f(power_location, materials[material_id].shininess);
+            } else {
+                // Shapes without a material: the placeholder texture, opaque and without highlights
                 glBindTexture(GL_TEXTURE_2D, rl_texture);
 
-            glUniform1i(texture_map_location, 1);
-
-            glUniform1i(shadow_cube_map_location, 2);
+                glUniform1f(alpha_location, 1.f);
 
-            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebos[shape_id]);
-            glDrawElements(GL_TRIANGLES, shapes[shape_id].mesh.indices.size(), GL_UNSIGNED_INT, nullptr);
+                glUniform3f(glossiness_location, 0.f, 0.f, 0.f);
+                glUniform1f(power_location, 1.f);
+            }
+            ++frame_stats.state_changes;
 
-            glDisable(GL_BLEND);
+            glMultiDrawElements(GL_TRIANGLES, batch.counts.data(), GL_UNSIGNED_INT, batch.offsets.data(), batch.counts.size());
+            ++frame_stats.draw_calls;
         }
 
+        glDisable(GL_BLEND);
+
         glUseProgram(debug_program);
         glBindTexture(GL_TEXTURE_2D, shadow_map);
         glBindVertexArray(debug_vao);
         glDrawArrays(GL_TRIANGLES, 0, 6);
+        ++frame_stats.draw_calls;
 
         SDL_GL_SwapWindow(window);
     }
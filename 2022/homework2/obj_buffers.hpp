@@ -0,0 +1,21 @@
+#pragma once
+
+#include "obj_parser.hpp"
+
+#include <GL/glew.h>
+
+// GPU buffers for obj_data: one interleaved vertex buffer and one index buffer.
+// All attributes of a vertex are read from one 32-byte record, which never
+// straddles a cache line, instead of from three separate buffers.
+
+static_assert(sizeof(obj_data::vertex) % 16 == 0, "obj_data::vertex should keep a 16-byte aligned stride");
+
+struct obj_buffers
+{
+    GLuint vbo = 0;
+    GLuint ebo = 0;
+};
+
+// Uploads the mesh and sets up attributes 0, 1 and 2 (position, normal, texcoord)
+// of the currently bound vertex array; the index buffer stays bound to it
+obj_buffers create_obj_buffers(obj_data const & mesh);
@@ -0,0 +1,20 @@
+#pragma once
+
+#include "obj_parser.hpp"
+
+#include <optional>
+
+// Binary cache of parsed OBJ data, stored next to the source file with the
+// .objc extension. The file is a fixed header followed by the raw
+// obj_data::vertex array and the index array, so loading it is a single
+// mapping and two copies. The header records the size, modification time and
+// content hash of the source it was built from; a cache is used only if the
+// size matches and either the time or the hash matches too.
+
+std::filesystem::path obj_cache_path(std::filesystem::path const & source_path);
+
+// Returns nothing if there is no cache for the source or it is stale or malformed
+std::optional<obj_data> load_obj_cache(std::filesystem::path const & source_path, obj_parse_stats * stats = nullptr);
+
+// Returns false if the cache could not be written, e.g. in a read-only directory
+bool save_obj_cache(std::filesystem::path const & source_path, obj_data const & data, obj_parse_stats const & stats);
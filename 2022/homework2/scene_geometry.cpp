@@ -0,0 +1,118 @@
+// The tinyobj implementation is compiled in this translation unit
+#define TINYOBJLOADER_IMPLEMENTATION
+#include "scene_geometry.hpp"
+
+#include <unordered_map>
+#include <algorithm>
+#include <numeric>
+
+namespace
+{
+
+    struct corner_key
+    {
+        int position;
+        int normal;
+        int texcoord;
+
+        bool operator == (corner_key const & other) const
+        {
+            return position == other.position && normal == other.normal && texcoord == other.texcoord;
+        }
+    };
+
+    struct corner_hash
+    {
+        std::size_t operator()(corner_key const & key) const
+        {
+            std::uint64_t h = static_cast<std::uint32_t>(key.position);
+            h = h * 0x9E3779B97F4A7C15ull + static_cast<std::uint32_t>(key.normal);
+            h = h * 0x9E3779B97F4A7C15ull + static_cast<std::uint32_t>(key.texcoord);
+            return h ^ (h >> 32);
+        }
+    };
+
+    int shape_material(tinyobj::shape_t const & shape)
+    {
+        return shape.mesh.material_ids.empty() ? -1 : shape.mesh.material_ids[0];
+    }
+
+}
+
+scene_geometry build_scene_geometry(tinyobj::attrib_t const & attrib, std::vector<tinyobj::shape_t> const & shapes,
+    scene_geometry_stats * stats)
+{
+    scene_geometry result;
+
+    std::size_t corners = 0;
+    for (auto const & shape : shapes)
+        corners += shape.mesh.indices.size();
+
+    // Shapes ordered by material, keeping the file order within a material
+    std::vector<std::size_t> order(shapes.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b){
+        return shape_material(shapes[a]) < shape_material(shapes[b]);
+    });
+
+    std::unordered_map<corner_key, std::uint32_t, corner_hash> vertex_ids;
+    vertex_ids.reserve(corners);
+
+    auto & vertices = result.mesh.vertices;
+    auto & indices = result.mesh.indices;
+
+    indices.reserve(corners);
+    result.shape_ranges.resize(shapes.size());
+
+    for (auto shape_id : order)
+    {
+        auto const & shape = shapes[shape_id];
+        int const material_id = shape_material(shape);
+
+        if (result.material_ranges.empty() || result.material_ranges.back().material_id != material_id)
+        {
+            scene_geometry::material_range range;
+            range.first = indices.size();
+            range.material_id = material_id;
+            result.material_ranges.push_back(range);
+        }
+
+        result.shape_ranges[shape_id].first = indices.size();
+        result.shape_ranges[shape_id].count = shape.mesh.indices.size();
+        result.material_ranges.back().count += shape.mesh.indices.size();
+
+        for (auto const & index : shape.mesh.indices)
+        {
+            corner_key const key{index.vertex_index, index.normal_index, index.texcoord_index};
+
+            auto [it, inserted] = vertex_ids.emplace(key, static_cast<std::uint32_t>(vertices.size()));
+            if (inserted)
+            {
+                auto & vertex = vertices.emplace_back();
+
+                for (int i = 0; i < 3; ++i)
+                    vertex.position[i] = attrib.vertices[3 * key.position + i];
+
+                for (int i = 0; i < 3; ++i)
+                    vertex.normal[i] = key.normal >= 0 ? attrib.normals[3 * key.normal + i] : 0.f;
+
+                for (int i = 0; i < 2; ++i)
+                    vertex.texcoord[i] = key.texcoord >= 0 ? attrib.texcoords[2 * key.texcoord + i] : 0.f;
+            }
+
+            indices.push_back(it->second);
+        }
+    }
+
+    if (stats)
+    {
+        constexpr std::size_t vertex_size = sizeof(obj_data::vertex);
+
+        stats->corners = corners;
+        stats->unique_vertices = vertices.size();
+        stats->unindexed_bytes = corners * vertex_size + corners * sizeof(std::uint32_t);
+        stats->indexed_bytes = vertices.size() * vertex_size + indices.size() * sizeof(std::uint32_t);
+    }
+
+    return result;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "tiny_obj_loader.h"
+#include "obj_parser.hpp"
+
+#include <vector>
+#include <cstdint>
+
+// Indexed geometry for a tinyobj scene: identical (position, normal, texcoord)
+// corners share a vertex, and the shapes are grouped by material so that all
+// of a material's triangles form one contiguous range of the index buffer.
+// The vertices are interleaved in the obj_parser layout, so the mesh can be
+// uploaded with the same code as parsed OBJ data (see obj_buffers.hpp).
+struct scene_geometry
+{
+    obj_data mesh;
+
+    struct range
+    {
+        // In indices, not bytes
+        std::size_t first = 0;
+        std::size_t count = 0;
+    };
+
+    // The triangles of shapes[shape_id], with the same count as shapes[shape_id].mesh.indices
+    std::vector<range> shape_ranges;
+
+    struct material_range : range
+    {
+        int material_id;
+    };
+
+    // One range per material used by the shapes, ordered by material_id
+    std::vector<material_range> material_ranges;
+};
+
+struct scene_geometry_stats
+{
+    std::size_t corners = 0;
+    std::size_t unique_vertices = 0;
+
+    // Size of the vertex and index buffers of the de-indexed layout,
+    // with one vertex per corner, and of the indexed one
+    std::size_t unindexed_bytes = 0;
+    std::size_t indexed_bytes = 0;
+};
+
+// A shape is assigned to the material of its first face, the same way it is drawn.
+// Corners without a normal or texcoord get zeros for them.
+scene_geometry build_scene_geometry(tinyobj::attrib_t const & attrib, std::vector<tinyobj::shape_t> const & shapes,
+    scene_geometry_stats * stats = nullptr);
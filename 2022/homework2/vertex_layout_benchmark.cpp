@@ -0,0 +1,202 @@
+#include "scene_geometry.hpp"
+
+#include <iostream>
+#include <chrono>
+#include <string>
+#include <random>
+#include <numeric>
+#include <cstdlib>
+#include <algorithm>
+
+// Usage: vertex_layout_benchmark [--iterations N] [--shuffle] file.obj
+// Walks the index buffer of the scene the way vertex fetch does and compares the
+// interleaved layout (one obj_data::vertex array) with separate attribute arrays:
+// the shadow pass reads only positions, the main pass reads every attribute.
+// With --shuffle, the vertices are put in random order first, so that nearly
+// every fetch misses the cache.
+
+namespace
+{
+
+    struct separate_arrays
+    {
+        std::vector<float> positions;
+        std::vector<float> normals;
+        std::vector<float> texcoords;
+    };
+
+    separate_arrays split(std::vector<obj_data::vertex> const & vertices)
+    {
+        separate_arrays result;
+        result.positions.reserve(vertices.size() * 3);
+        result.normals.reserve(vertices.size() * 3);
+        result.texcoords.reserve(vertices.size() * 2);
+
+        for (auto const & vertex : vertices)
+        {
+            result.positions.insert(result.positions.end(), vertex.position.begin(), vertex.position.end());
+            result.normals.insert(result.normals.end(), vertex.normal.begin(), vertex.normal.end());
+            result.texcoords.insert(result.texcoords.end(), vertex.texcoord.begin(), vertex.texcoord.end());
+        }
+
+        return result;
+    }
+
+    void shuffle_vertices(obj_data & mesh)
+    {
+        std::vector<std::uint32_t> order(mesh.vertices.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::shuffle(order.begin(), order.end(), std::mt19937(12345));
+
+        std::vector<std::uint32_t> remap(order.size());
+        std::vector<obj_data::vertex> vertices(order.size());
+        for (std::size_t i = 0; i < order.size(); ++i)
+        {
+            remap[order[i]] = i;
+            vertices[i] = mesh.vertices[order[i]];
+        }
+
+        for (auto & index : mesh.indices)
+            index = remap[index];
+        mesh.vertices = std::move(vertices);
+    }
+
+    // Every component has its own sum, so that the loops are bound by the fetches
+    // rather than by a single chain of dependent additions
+
+    float shadow_pass(std::vector<obj_data::vertex> const & vertices, std::vector<std::uint32_t> const & indices)
+    {
+        float sum[3] = {};
+        for (auto index : indices)
+        {
+            auto const & v = vertices[index];
+            for (int i = 0; i < 3; ++i)
+                sum[i] += v.position[i];
+        }
+        return sum[0] + sum[1] + sum[2];
+    }
+
+    float shadow_pass(separate_arrays const & arrays, std::vector<std::uint32_t> const & indices)
+    {
+        float sum[3] = {};
+        for (auto index : indices)
+        {
+            float const * p = arrays.positions.data() + 3 * index;
+            for (int i = 0; i < 3; ++i)
+                sum[i] += p[i];
+        }
+        return sum[0] + sum[1] + sum[2];
+    }
+
+    float main_pass(std::vector<obj_data::vertex> const & vertices, std::vector<std::uint32_t> const & indices)
+    {
+        float sum[8] = {};
+        for (auto index : indices)
+        {
+            auto const & v = vertices[index];
+            for (int i = 0; i < 3; ++i)
+                sum[i] += v.position[i];
+            for (int i = 0; i < 3; ++i)
+                sum[3 + i] += v.normal[i];
+            for (int i = 0; i < 2; ++i)
+                sum[6 + i] += v.texcoord[i];
+        }
+        return std::accumulate(sum, sum + 8, 0.f);
+    }
+
+    float main_pass(separate_arrays const & arrays, std::vector<std::uint32_t> const & indices)
+    {
+        float sum[8] = {};
+        for (auto index : indices)
+        {
+            float const * p = arrays.positions.data() + 3 * index;
+            float const * n = arrays.normals.data() + 3 * index;
+            float const * t = arrays.texcoords.data() + 2 * index;
+            for (int i = 0; i < 3; ++i)
+                sum[i] += p[i];
+            for (int i = 0; i < 3; ++i)
+                sum[3 + i] += n[i];
+            for (int i = 0; i < 2; ++i)
+                sum[6 + i] += t[i];
+        }
+        return std::accumulate(sum, sum + 8, 0.f);
+    }
+
+    template <typename Pass>
+    double measure(int iterations, float & checksum, Pass && pass)
+    {
+        double best_time = 1e30;
+        for (int i = 0; i < iterations; ++i)
+        {
+            auto start = std::chrono::high_resolution_clock::now();
+            checksum += pass();
+            auto end = std::chrono::high_resolution_clock::now();
+
+            best_time = std::min(best_time, std::chrono::duration_cast<std::chrono::duration<double>>(end - start).count());
+        }
+        return best_time;
+    }
+
+}
+
+int main(int argc, char ** argv) try
+{
+    int iterations = 10;
+    bool shuffle = false;
+    std::filesystem::path path;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (argv[i] == std::string("--iterations") && i + 1 < argc)
+            iterations = std::max(1, std::atoi(argv[++i]));
+        else if (argv[i] == std::string("--shuffle"))
+            shuffle = true;
+        else
+            path = argv[i];
+    }
+
+    if (path.empty())
+    {
+        std::cerr << "Usage: " << argv[0] << " [--iterations N] [--shuffle] file.obj" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    tinyobj::attrib_t attrib;
+    std::vector<tinyobj::shape_t> shapes;
+    std::vector<tinyobj::material_t> materials;
+    std::string warn, err;
+
+    if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, path.string().c_str(), path.parent_path().string().c_str()))
+        throw std::runtime_error("Failed to load " + path.string() + ": " + err);
+
+    scene_geometry geometry = build_scene_geometry(attrib, shapes);
+    obj_data & mesh = geometry.mesh;
+
+    if (shuffle)
+        shuffle_vertices(mesh);
+
+    separate_arrays const arrays = split(mesh.vertices);
+
+    float checksum = 0.f;
+
+    double const aos_shadow = measure(iterations, checksum, [&]{ return shadow_pass(mesh.vertices, mesh.indices); });
+    double const soa_shadow = measure(iterations, checksum, [&]{ return shadow_pass(arrays, mesh.indices); });
+    double const aos_main = measure(iterations, checksum, [&]{ return main_pass(mesh.vertices, mesh.indices); });
+    double const soa_main = measure(iterations, checksum, [&]{ return main_pass(arrays, mesh.indices); });
+
+    double const per_index = 1e9 / mesh.indices.size();
+
+    std::cout << path.string() << (shuffle ? " (shuffled)" : "") << '\n';
+    std::cout << "    vertices:             " << mesh.vertices.size() << '\n';
+    std::cout << "    indices:              " << mesh.indices.size() << '\n';
+    std::cout << "    shadow, interleaved:  " << aos_shadow * 1000.0 << " ms (" << aos_shadow * per_index << " ns/index)\n";
+    std::cout << "    shadow, separate:     " << soa_shadow * 1000.0 << " ms (" << soa_shadow * per_index << " ns/index)\n";
+    std::cout << "    main, interleaved:    " << aos_main * 1000.0 << " ms (" << aos_main * per_index << " ns/index)\n";
+    std::cout << "    main, separate:       " << soa_main * 1000.0 << " ms (" << soa_main * per_index << " ns/index)\n";
+    std::cout << "    checksum:             " << checksum << '\n';
+}
+catch (std::exception const & e)
+{
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+}
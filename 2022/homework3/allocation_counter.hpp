@@ -0,0 +1,9 @@
+#pragma once
+
+#include <cstddef>
+
+// Linking allocation_counter.cpp replaces the program's global operator new and
+// delete (single and array forms) with ones that count the allocations, for
+// benchmarks that check a loop doesn't touch the heap. The aligned overloads,
+// used for over-aligned types, are left to the standard library and not counted.
+std::size_t allocation_count();
@@ -0,0 +1,256 @@
+#include "gltf_loader.hpp"
+#include "baked_animation.hpp"
+#include "animation_sampler.hpp"
+#include "skeleton_evaluator.hpp"
+#include "crowd_animation.hpp"
+
+#include <iostream>
+#include <chrono>
+#include <string>
+#include <cstdlib>
+#include <algorithm>
+
+// Usage: animation_benchmark [--iterations N] [--rate FPS] [--crowd N] [file.gltf]
+// Samples every bone of the model's first animation at a series of increasing
+// playback times: through the keyframe splines with a binary search per channel,
+// through an animation_sampler that keeps a keyframe cursor per channel, and
+// through the animation baked at the given rate. Prints the cost per sampled
+// frame and the largest difference of the baked poses from the exact ones.
+// Then turns the poses into bone matrices, the scalar glm way and through
+// skeleton_evaluator, and compares those too. Finally updates a crowd of the
+// given size on one thread and on all of them.
+
+namespace
+{
+
+    // Playback times spread over the clip, the way a 60 fps main loop would sample it
+    constexpr int sample_count = 1000;
+
+    template <typename Pass>
+    double measure(int iterations, Pass && pass)
+    {
+        double best_time = 1e30;
+        for (int i = 0; i < iterations; ++i)
+        {
+            auto start = std::chrono::high_resolution_clock::now();
+            pass();
+            auto end = std::chrono::high_resolution_clock::now();
+
+            best_time = std::min(best_time, std::chrono::duration_cast<std::chrono::duration<double>>(end - start).count());
+        }
+        return best_time;
+    }
+
+    void sample_splines(gltf_model::animation const & animation, float time, skeleton_pose & pose)
+    {
+        pose.resize(animation.bones.size());
+        for (std::size_t i = 0; i < animation.bones.size(); ++i)
+        {
+            pose.translations[i] = animation.bones[i].translation(time);
+            pose.rotations[i] = animation.bones[i].rotation(time);
+            pose.scales[i] = animation.bones[i].scale(time);
+        }
+    }
+
+    // The bone matrices the way homework3 used to compute them; `worlds` is scratch storage
+    void evaluate_glm(std::vector<gltf_model::bone> const & bones, gltf_model::skin const & skin, skeleton_pose const & pose,
+        std::vector<glm::mat4> & worlds, std::vector<glm::mat4x3> & palette)
+    {
+        worlds.resize(bones.size());
+        for (std::size_t i = 0; i < bones.size(); ++i)
+        {
+            glm::mat4 const transform = glm::translate(glm::mat4(1.f), pose.translations[i])
+                * glm::toMat4(pose.rotations[i]) * glm::scale(glm::mat4(1.f), pose.scales[i]);
+            worlds[i] = transform;
+            if (bones[i].parent != -1)
+                worlds[i] = worlds[bones[i].parent] * transform;
+        }
+        for (std::size_t j = 0; j < skin.joints.size(); ++j)
+            palette[j] = worlds[skin.joints[j]] * skin.inverse_bind_matrices[j];
+    }
+
+    float checksum(std::vector<glm::mat4x3> const & palette)
+    {
+        float result = 0.f;
+        for (auto const & m : palette)
+            result += m[0][0] + m[1][1] + m[2][2] + m[3][0];
+        return result;
+    }
+
+    float checksum(skeleton_pose const & pose)
+    {
+        float result = 0.f;
+        for (std::size_t i = 0; i < pose.size(); ++i)
+            result += pose.translations[i].x + pose.rotations[i].w + pose.scales[i].x;
+        return result;
+    }
+
+}
+
+int main(int argc, char ** argv) try
+{
+    int iterations = 10;
+    float rate = 60.f;
+    std::size_t crowd_size = 1000;
+    std::filesystem::path path = PROJECT_ROOT "/Macarena/Macarena.gltf";
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (argv[i] == std::string("--iterations") && i + 1 < argc)
+            iterations = std::max(1, std::atoi(argv[++i]));
+        else if (argv[i] == std::string("--rate") && i + 1 < argc)
+            rate = std::max(1.f, static_cast<float>(std::atof(argv[++i])));
+        else if (argv[i] == std::string("--crowd") && i + 1 < argc)
+            crowd_size = std::max(1, std::atoi(argv[++i]));
+        else
+            path = argv[i];
+    }
+
+    auto const model = load_gltf(path);
+    if (model.animations.empty())
+        throw std::runtime_error("No animations in " + path.string());
+
+    auto const & [name, animation] = *model.animations.begin();
+
+    baked_animation baked;
+    double const bake_time = measure(iterations, [&]{ baked = bake_animation(animation, rate); });
+
+    auto sample_time = [&](int i){ return animation.max_time * i / sample_count; };
+
+    skeleton_pose pose;
+    float sum = 0.f;
+
+    double const spline_time = measure(iterations, [&]{
+        for (int i = 0; i < sample_count; ++i)
+        {
+            sample_splines(animation, sample_time(i), pose);
+            sum += checksum(pose);
+        }
+    });
+
+    animation_sampler sampler(animation);
+
+    double const cursor_time = measure(iterations, [&]{
+        for (int i = 0; i < sample_count; ++i)
+        {
+            sampler.sample(sample_time(i), pose);
+            sum += checksum(pose);
+        }
+    });
+
+    double const baked_time = measure(iterations, [&]{
+        for (int i = 0; i < sample_count; ++i)
+        {
+            baked.sample(sample_time(i), pose);
+            sum += checksum(pose);
+        }
+    });
+
+    // Between keyframes the baked pose is an interpolation of interpolations,
+    // so it differs slightly from sampling the splines directly
+    float translation_error = 0.f;
+    float rotation_error = 0.f;
+    // The cursors must find exactly the keyframes the binary search finds
+    std::size_t cursor_mismatches = 0;
+    skeleton_pose reference;
+    sampler.reset();
+    for (int i = 0; i < sample_count; ++i)
+    {
+        sample_splines(animation, sample_time(i), reference);
+
+        sampler.sample(sample_time(i), pose);
+        for (std::size_t b = 0; b < pose.size(); ++b)
+        {
+            if (pose.translations[b] != reference.translations[b] || pose.rotations[b] != reference.rotations[b]
+                || pose.scales[b] != reference.scales[b])
+                ++cursor_mismatches;
+        }
+
+        baked.sample(sample_time(i), pose);
+        for (std::size_t b = 0; b < pose.size(); ++b)
+        {
+            translation_error = std::max(translation_error, glm::length(pose.translations[b] - reference.translations[b]));
+            // The angle of the relative rotation, without the precision loss of acos near 1
+            glm::quat const delta = pose.rotations[b] * glm::inverse(reference.rotations[b]);
+            rotation_error = std::max(rotation_error, 2.f * std::atan2(glm::length(glm::vec3(delta.x, delta.y, delta.z)), std::abs(delta.w)));
+        }
+    }
+
+    // Bone matrices for every baked pose
+    std::vector<skeleton_pose> poses(sample_count);
+    for (int i = 0; i < sample_count; ++i)
+        baked.sample(sample_time(i), poses[i]);
+
+    auto const & skin = model.skins[drawn_skin(model)];
+    skeleton_evaluator evaluator(model.bones, skin);
+    std::vector<glm::mat4> worlds;
+    std::vector<glm::mat4x3> palette(evaluator.size());
+    std::vector<glm::mat4x3> reference_palette(evaluator.size());
+
+    double const glm_palette_time = measure(iterations, [&]{
+        for (auto const & pose : poses)
+        {
+            evaluate_glm(model.bones, skin, pose, worlds, palette);
+            sum += checksum(palette);
+        }
+    });
+
+    double const simd_palette_time = measure(iterations, [&]{
+        for (auto const & pose : poses)
+        {
+            evaluator.evaluate(pose, palette);
+            sum += checksum(palette);
+        }
+    });
+
+    float palette_error = 0.f;
+    for (auto const & pose : poses)
+    {
+        evaluate_glm(model.bones, skin, pose, worlds, reference_palette);
+        evaluator.evaluate(pose, palette);
+        for (std::size_t b = 0; b < palette.size(); ++b)
+            for (int c = 0; c < 4; ++c)
+                palette_error = std::max(palette_error, glm::length(palette[b][c] - reference_palette[b][c]));
+    }
+
+    worker_pool single_thread(1);
+    worker_pool all_threads;
+    crowd_animation crowd(model.bones, skin, baked, crowd_size, all_threads.size());
+
+    auto update_crowd = [&](worker_pool & pool){
+        return measure(iterations, [&]{
+            crowd.update(1.f, pool);
+            sum += crowd.palettes()[crowd_size - 1][3][0];
+        });
+    };
+
+    double const crowd_single_time = update_crowd(single_thread);
+    double const crowd_parallel_time = update_crowd(all_threads);
+
+    std::size_t const baked_bytes = baked.translations.size() * sizeof(glm::vec3)
+        + baked.rotations.size() * sizeof(glm::quat) + baked.scales.size() * sizeof(glm::vec3);
+    double const per_frame = 1e9 / sample_count;
+
+    std::cout << path.string() << ", animation " << name << '\n';
+    std::cout << "    bones:                " << animation.bones.size() << '\n';
+    std::cout << "    duration:             " << animation.max_time << " s\n";
+    std::cout << "    baked frames:         " << baked.frame_count << " (" << baked.frame_rate << " fps, " << baked_bytes / 1024 << " KB)\n";
+    std::cout << "    bake:                 " << bake_time * 1000.0 << " ms\n";
+    std::cout << "    splines:              " << spline_time * per_frame << " ns/frame\n";
+    std::cout << "    splines, cursors:     " << cursor_time * per_frame << " ns/frame\n";
+    std::cout << "    baked:                " << baked_time * per_frame << " ns/frame\n";
+    std::cout << "    cursor mismatches:    " << cursor_mismatches << '\n';
+    std::cout << "    translation error:    " << translation_error << '\n';
+    std::cout << "    rotation error:       " << glm::degrees(rotation_error) << " degrees\n";
+    std::cout << "    matrices, glm:        " << glm_palette_time * per_frame << " ns/frame\n";
+    std::cout << "    matrices, simd:       " << simd_palette_time * per_frame << " ns/frame\n";
+    std::cout << "    matrix error:         " << palette_error << '\n';
+    std::cout << "    crowd of " << crowd_size << ", 1 thread:  " << crowd_single_time * 1000.0 << " ms\n";
+    std::cout << "    crowd of " << crowd_size << ", " << all_threads.size() << " threads: " << crowd_parallel_time * 1000.0 << " ms\n";
+    std::cout << "    checksum:             " << sum << '\n';
+}
+catch (std::exception const & e)
+{
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+}
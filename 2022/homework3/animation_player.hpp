@@ -0,0 +1,72 @@
+#pragma once
+
+#include "gltf_loader.hpp"
+#include "skeleton_pose.hpp"
+#include "animation_sampler.hpp"
+
+#include <vector>
+#include <cstddef>
+
+// Plays and blends several animations of one skeleton. Every playing animation
+// is a layer with its own time, speed and weight; the pose is the weighted
+// average of the layers' poses (normalized by the total weight, so weights
+// needn't sum to one). Cross-fades move the weights over time and drop the
+// layers that faded out.
+//
+// Everything a frame needs - the layers, their samplers and their poses - is
+// allocated in the constructor, so that update() and evaluate() never touch
+// the heap, nor do play/cross_fade/set_weight once every animation they are
+// given has been played at least once by its layer.
+// Animations are referenced, not copied, and must outlive the player;
+// look them up in gltf_model::animations once, not every frame.
+struct animation_player
+{
+    // The skeleton's bones give the rest pose, what evaluate() returns with nothing playing
+    animation_player(std::vector<gltf_model::bone> const & bones, std::size_t max_layers = 4);
+
+    std::size_t bone_count() const { return bone_count_; }
+    std::size_t layer_count() const { return layer_count_; }
+
+    // Stops everything else and plays the animation alone, from the start
+    void play(gltf_model::animation const & animation);
+
+    // Fades the animation in to weight 1 and everything else out to 0 over
+    // `duration` seconds. An animation that is already playing keeps its time.
+    void cross_fade(gltf_model::animation const & animation, float duration);
+
+    // Sets the weight immediately, starting the animation if it isn't playing.
+    // A layer with zero weight set this way keeps playing (and contributes nothing)
+    // until the next play() or cross_fade(), which stop it.
+    void set_weight(gltf_model::animation const & animation, float weight);
+    void set_speed(gltf_model::animation const & animation, float speed);
+
+    // Advances the time of every layer, wrapping it to its animation's duration, and the fades
+    void update(float dt);
+
+    // Samples every layer and blends the results into `pose`, which is resized to bone_count().
+    // With nothing playing the result is the rest pose.
+    void evaluate(skeleton_pose & pose);
+
+private:
+    struct layer
+    {
+        animation_sampler sampler;
+        skeleton_pose pose;
+        float time = 0.f;
+        float speed = 1.f;
+        float weight = 0.f;
+        // The weight the layer fades to, by `fade_speed` per second
+        float target_weight = 0.f;
+        float fade_speed = 0.f;
+    };
+
+    std::size_t bone_count_;
+    skeleton_pose rest_pose_;
+    // The first layer_count_ layers are playing, the rest are kept for their storage
+    std::size_t layer_count_ = 0;
+    std::vector<layer> layers_;
+
+    layer * find(gltf_model::animation const & animation);
+    layer & find_or_add(gltf_model::animation const & animation);
+    void remove(std::size_t index);
+};
@@ -0,0 +1,140 @@
+#include "gltf_loader.hpp"
+#include "animation_player.hpp"
+#include "skeleton_evaluator.hpp"
+#include "allocation_counter.hpp"
+
+#include <iostream>
+#include <chrono>
+#include <string>
+#include <cstdlib>
+#include <cstdio>
+#include <algorithm>
+
+// Usage: animation_player_benchmark [--frames N] [--fade SECONDS] [file.gltf]
+// Plays the model's animations one after another through an animation_player,
+// cross-fading from each to the next, and turns every blended pose into bone
+// matrices, as a main loop at 60 fps would. Counts the heap allocations made
+// after the first cycle through the animations and fails if there are any.
+// Also compares a two-animation blend with slerp of the two poses.
+
+namespace
+{
+
+    float checksum(std::vector<glm::mat4x3> const & palette)
+    {
+        float result = 0.f;
+        for (auto const & m : palette)
+            result += m[0][0] + m[1][1] + m[2][2] + m[3][0];
+        return result;
+    }
+
+}
+
+int main(int argc, char ** argv) try
+{
+    int frames = 100000;
+    float fade = 0.5f;
+    std::filesystem::path path = PROJECT_ROOT "/wolf/Wolf-Blender-2.82a.gltf";
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (argv[i] == std::string("--frames") && i + 1 < argc)
+            frames = std::max(1, std::atoi(argv[++i]));
+        else if (argv[i] == std::string("--fade") && i + 1 < argc)
+            fade = std::max(0.f, static_cast<float>(std::atof(argv[++i])));
+        else
+            path = argv[i];
+    }
+
+    auto const model = load_gltf(path);
+    if (model.animations.empty())
+        throw std::runtime_error("No animations in " + path.string());
+
+    // Looked up once; the player only keeps these references
+    std::vector<gltf_model::animation const *> animations;
+    for (auto const & [name, animation] : model.animations)
+        animations.push_back(&animation);
+
+    float const dt = 1.f / 60.f;
+    // Every animation plays for a couple of seconds, the fades included
+    int const frames_per_animation = static_cast<int>((fade + 2.f) / dt);
+
+    animation_player player(model.bones);
+    skeleton_evaluator evaluator(model.bones, model.skins[drawn_skin(model)]);
+    skeleton_pose pose;
+    std::vector<glm::mat4x3> palette(evaluator.size());
+    float sum = 0.f;
+
+    auto run = [&](int first_frame, int frame_count){
+        for (int frame = first_frame; frame < first_frame + frame_count; ++frame)
+        {
+            if (frame % frames_per_animation == 0)
+                player.cross_fade(*animations[(frame / frames_per_animation) % animations.size()], fade);
+
+            player.update(dt);
+            player.evaluate(pose);
+            evaluator.evaluate(pose, palette);
+            sum += checksum(palette);
+        }
+    };
+
+    // Warm up: every animation gets played once, and the pose gets its size
+    int const warmup_frames = frames_per_animation * static_cast<int>(animations.size());
+    run(0, warmup_frames);
+
+    std::size_t const allocations_before = allocation_count();
+    auto start = std::chrono::high_resolution_clock::now();
+    run(warmup_frames, frames);
+    auto end = std::chrono::high_resolution_clock::now();
+    std::size_t const allocations = allocation_count() - allocations_before;
+
+    double const frame_time = std::chrono::duration_cast<std::chrono::duration<double>>(end - start).count() / frames;
+
+    // Halfway between two animations the normalized sum is close to slerp,
+    // but not equal to it for rotations far apart
+    float blend_error = 0.f;
+    if (animations.size() >= 2)
+    {
+        animation_sampler first(*animations[0]), second(*animations[1]);
+        skeleton_pose first_pose, second_pose;
+
+        animation_player blend(model.bones);
+        blend.set_weight(*animations[0], 0.5f);
+        blend.set_weight(*animations[1], 0.5f);
+
+        for (int frame = 0; frame < 600; ++frame)
+        {
+            float const time = frame * dt;
+            blend.evaluate(pose);
+            first.sample(std::fmod(time, animations[0]->max_time), first_pose);
+            second.sample(std::fmod(time, animations[1]->max_time), second_pose);
+            blend.update(dt);
+
+            for (std::size_t b = 0; b < pose.size(); ++b)
+            {
+                glm::quat const delta = pose.rotations[b] * glm::inverse(glm::slerp(first_pose.rotations[b], second_pose.rotations[b], 0.5f));
+                blend_error = std::max(blend_error, 2.f * std::atan2(glm::length(glm::vec3(delta.x, delta.y, delta.z)), std::abs(delta.w)));
+            }
+        }
+    }
+
+    std::cout << path.string() << '\n';
+    std::cout << "    animations:           " << animations.size() << '\n';
+    std::cout << "    bones:                " << model.bones.size() << '\n';
+    std::cout << "    frames:               " << frames << " (" << fade << " s cross-fade every " << frames_per_animation << ")\n";
+    std::cout << "    frame:                " << frame_time * 1e9 << " ns\n";
+    std::cout << "    blend vs slerp:       " << glm::degrees(blend_error) << " degrees\n";
+    std::cout << "    checksum:             " << sum << '\n';
+    std::cout << "    allocations:          " << allocations << '\n';
+
+    if (allocations != 0)
+    {
+        std::cerr << "Steady-state frames allocated memory" << std::endl;
+        return EXIT_FAILURE;
+    }
+}
+catch (std::exception const & e)
+{
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,37 @@
+#include "animation_sampler.hpp"
+
+#include <cassert>
+
+animation_sampler::animation_sampler(gltf_model::animation const & animation)
+    : animation_(&animation)
+    , cursors_(animation.bones.size())
+{}
+
+void animation_sampler::set_animation(gltf_model::animation const & animation)
+{
+    animation_ = &animation;
+    cursors_.assign(animation.bones.size(), bone_cursors{});
+}
+
+void animation_sampler::sample(float time, skeleton_pose & pose)
+{
+    assert(animation_);
+
+    auto const & bones = animation_->bones;
+    pose.resize(bones.size());
+
+    for (std::size_t i = 0; i < bones.size(); ++i)
+    {
+        auto const & bone = bones[i];
+        auto & cursors = cursors_[i];
+
+        pose.translations[i] = bone.translation.values.empty() ? bone.rest_translation : bone.translation(time, cursors.translation);
+        pose.rotations[i] = bone.rotation.values.empty() ? bone.rest_rotation : bone.rotation(time, cursors.rotation);
+        pose.scales[i] = bone.scale.values.empty() ? bone.rest_scale : bone.scale(time, cursors.scale);
+    }
+}
+
+void animation_sampler::reset()
+{
+    std::fill(cursors_.begin(), cursors_.end(), bone_cursors{});
+}
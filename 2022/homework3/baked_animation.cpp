@@ -0,0 +1,55 @@
+#include "baked_animation.hpp"
+#include "animation_sampler.hpp"
+
+#include <cmath>
+
+baked_animation bake_animation(gltf_model::animation const & animation, float frame_rate)
+{
+    baked_animation result;
+    result.bone_count = animation.bones.size();
+    result.duration = animation.max_time;
+
+    std::size_t const intervals = std::max<std::size_t>(1, std::ceil(animation.max_time * frame_rate));
+    result.frame_count = intervals + 1;
+    result.frame_rate = (animation.max_time > 0.f) ? intervals / animation.max_time : frame_rate;
+
+    std::size_t const size = result.frame_count * result.bone_count;
+    result.translations.reserve(size);
+    result.rotations.reserve(size);
+    result.scales.reserve(size);
+
+    // Frames are sampled in order, so the cursors only ever step forward
+    animation_sampler sampler(animation);
+    skeleton_pose pose;
+
+    for (std::size_t frame = 0; frame < result.frame_count; ++frame)
+    {
+        float const time = std::min(frame / result.frame_rate, result.duration);
+        sampler.sample(time, pose);
+
+        result.translations.insert(result.translations.end(), pose.translations.begin(), pose.translations.end());
+        result.rotations.insert(result.rotations.end(), pose.rotations.begin(), pose.rotations.end());
+        result.scales.insert(result.scales.end(), pose.scales.begin(), pose.scales.end());
+    }
+
+    return result;
+}
+
+void baked_animation::sample(float time, skeleton_pose & pose) const
+{
+    pose.resize(bone_count);
+
+    float const position = std::clamp(time * frame_rate, 0.f, static_cast<float>(frame_count - 1));
+    std::size_t const frame = std::min(static_cast<std::size_t>(position), frame_count - 2);
+    float const t = position - frame;
+
+    std::size_t const first = frame * bone_count;
+    std::size_t const second = first + bone_count;
+
+    for (std::size_t i = 0; i < bone_count; ++i)
+    {
+        pose.translations[i] = glm::lerp(translations[first + i], translations[second + i], t);
+        pose.rotations[i] = glm::slerp(rotations[first + i], rotations[second + i], t);
+        pose.scales[i] = glm::lerp(scales[first + i], scales[second + i], t);
+    }
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "gltf_loader.hpp"
+#include "skeleton_pose.hpp"
+
+#include <vector>
+#include <span>
+#include <cstddef>
+
+// An animation resampled at a fixed rate, so that sampling it is a couple of
+// array reads and an interpolation instead of a binary search per channel.
+// The tables are frame-major: all bones of a frame are contiguous.
+struct baked_animation
+{
+    std::size_t bone_count = 0;
+    std::size_t frame_count = 0;
+    // Frames per second, adjusted so that the last frame falls exactly on `duration`
+    float frame_rate = 0.f;
+    float duration = 0.f;
+
+    std::vector<glm::vec3> translations;
+    std::vector<glm::quat> rotations;
+    std::vector<glm::vec3> scales;
+
+    // Linear interpolation of translation and scale, slerp of rotation between
+    // the two frames around `time`, which is clamped to [0, duration]
+    void sample(float time, skeleton_pose & pose) const;
+};
+
+// Samples the animation's splines at (at least) `frame_rate` frames per second.
+// Channels without keyframes get the bone's rest transform, as in animation_sampler.
+baked_animation bake_animation(gltf_model::animation const & animation, float frame_rate = 60.f);
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "worker_pool.hpp"
+
+#include <vector>
+#include <span>
+#include <array>
+#include <cstdint>
+
+#define GLM_FORCE_SWIZZLE
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+#include <glm/mat3x3.hpp>
+#include <glm/mat4x3.hpp>
+#include <glm/mat4x4.hpp>
+
+// Linear blend skinning on the CPU, computing the same thing as the skinning
+// vertex shaders: every vertex is transformed by the weighted sum of the
+// matrices of (up to) four bones. It serves as a reference for the shaders
+// and as a fallback when vertex shaders are too slow or unavailable.
+
+// The rest pose of a skinned mesh with its bone influences, converted once
+// from whatever layout the mesh was loaded in
+struct skinning_mesh
+{
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec3> normals;
+    std::vector<std::array<std::uint16_t, 4>> joints;
+    // Unused influences have zero weight
+    std::vector<glm::vec4> weights;
+
+    std::size_t size() const { return positions.size(); }
+};
+
+struct skinned_vertices
+{
+    std::vector<glm::vec3> positions;
+    // Transformed by the blended matrix like positions, but without translation,
+    // and not renormalized (as in the shaders)
+    std::vector<glm::vec3> normals;
+};
+
+// `palette` holds one matrix per joint of the skin, indexed by the mesh's joints. The vertices
+// are split between the pool's workers; `result` is resized to the mesh size,
+// so skinning the same mesh again doesn't allocate.
+void skin_mesh(skinning_mesh const & mesh, std::span<glm::mat4x3 const> palette, skinned_vertices & result, worker_pool & pool);
+
+// The same on the calling thread, one vertex at a time with glm, as the linear blend skinning
+// in the shaders. It doesn't reproduce their `average /= 2.5` (wolf_shaders.h, shadow_shaders.h):
+// that scales the wolf down to the scene and belongs with the model matrix, not the skinning,
+// so to compare with the wolf as drawn scale these results by 1 / 2.5 about the origin.
+void skin_mesh_reference(skinning_mesh const & mesh, std::span<glm::mat4x3 const> palette, skinned_vertices & result);
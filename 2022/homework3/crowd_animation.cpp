@@ -0,0 +1,48 @@
+#include "crowd_animation.hpp"
+
+#include <cmath>
+
+crowd_animation::crowd_animation(std::span<gltf_model::bone const> bones, gltf_model::skin const & skin,
+    baked_animation const & animation, std::size_t instance_count, std::size_t worker_count)
+    : animation_(&animation)
+    , palette_size_(skin.joints.size())
+    , time_offsets_(instance_count)
+    , palettes_(instance_count * skin.joints.size(), glm::mat4x3(1.f))
+{
+    assert(animation.bone_count == bones.size());
+
+    // Offsets spread evenly over the animation by the golden ratio,
+    // so that neighbouring instances are never in step
+    constexpr float golden_ratio_fraction = 0.6180339887f;
+    for (std::size_t i = 0; i < instance_count; ++i)
+    {
+        float offset = i * golden_ratio_fraction;
+        time_offsets_[i] = (offset - std::floor(offset)) * animation.duration;
+    }
+
+    scratch_.reserve(worker_count);
+    for (std::size_t i = 0; i < worker_count; ++i)
+    {
+        auto & scratch = scratch_.emplace_back(worker_scratch{skeleton_evaluator(bones, skin), skeleton_pose{}});
+        scratch.pose.resize(bones.size());
+    }
+}
+
+void crowd_animation::update(float time, worker_pool & pool)
+{
+    assert(pool.size() <= scratch_.size());
+
+    float const duration = animation_->duration;
+
+    pool.parallel_for(instance_count(), [&](std::size_t begin, std::size_t end, std::size_t worker)
+    {
+        auto & scratch = scratch_[worker];
+
+        for (std::size_t i = begin; i < end; ++i)
+        {
+            float const instance_time = (duration > 0.f) ? std::fmod(time + time_offsets_[i], duration) : 0.f;
+            animation_->sample(instance_time, scratch.pose);
+            scratch.evaluator.evaluate(scratch.pose, std::span(palettes_).subspan(i * palette_size_, palette_size_));
+        }
+    });
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "baked_animation.hpp"
+#include "skeleton_evaluator.hpp"
+#include "worker_pool.hpp"
+
+#include <vector>
+#include <span>
+
+// Many instances of one skinned character playing the same baked animation,
+// each from its own point in time. The bone matrices of all instances are
+// evaluated in parallel into one array, instance after instance, to be
+// uploaded with a single call into the texture buffer the shaders read.
+// The animation is referenced, not copied, and must outlive the crowd.
+struct crowd_animation
+{
+    crowd_animation(std::span<gltf_model::bone const> bones, gltf_model::skin const & skin,
+        baked_animation const & animation, std::size_t instance_count, std::size_t worker_count);
+
+    std::size_t instance_count() const { return time_offsets_.size(); }
+    // The number of matrices in the palette of an instance, one per joint of the skin
+    std::size_t palette_size() const { return palette_size_; }
+
+    // Instance i plays the animation at time + time_offset(i), wrapped to the animation's duration
+    float time_offset(std::size_t instance) const { return time_offsets_[instance]; }
+
+    // `worker_count` must not be less than pool.size()
+    void update(float time, worker_pool & pool);
+
+    // palette_size() matrices per instance
+    std::span<glm::mat4x3 const> palettes() const { return palettes_; }
+
+private:
+    baked_animation const * animation_;
+    std::size_t palette_size_;
+    std::vector<float> time_offsets_;
+    std::vector<glm::mat4x3> palettes_;
+
+    struct worker_scratch
+    {
+        skeleton_evaluator evaluator;
+        skeleton_pose pose;
+    };
+
+    std::vector<worker_scratch> scratch_;
+};
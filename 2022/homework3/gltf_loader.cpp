@@ -1,10 +1,14 @@
 #include "gltf_loader.hpp"
 
-#include <rapidjson/document.h>
-#include <rapidjson/istreamwrapper.h>
+#include "json_document.hpp"
 
-#include <fstream>
 #include <stdexcept>
+#include <cstring>
+#include <cstdint>
+#include <tuple>
+
+#include <glm/ext/matrix_transform.hpp>
+#include <glm/gtx/matrix_decompose.hpp>
 
 static unsigned int attribute_type_to_size(std::string const & type)
 {
@@ -16,52 +20,158 @@ static unsigned int attribute_type_to_size(std::string const & type)
     throw std::runtime_error("Unknown attribute type: " + type);
 }
 
-gltf_model load_gltf(std::filesystem::path const & path)
+// A node's transform is translation * rotation * scale, so this gets them back
+static void decompose_transform(glm::mat4 const & transform, glm::vec3 & translation, glm::quat & rotation, glm::vec3 & scale)
+{
+    glm::vec3 skew;
+    glm::vec4 perspective;
+    if (!glm::decompose(transform, scale, rotation, translation, skew, perspective))
+    {
+        translation = glm::vec3(transform[3]);
+        rotation = glm::quat(1.f, 0.f, 0.f, 0.f);
+        scale = glm::vec3(1.f);
+    }
+}
+
+struct glb_chunks
+{
+    std::span<char const> json;
+    std::span<char const> bin;
+};
+
+// See https://registry.khronos.org/glTF/specs/2.0/glTF-2.0.html#binary-gltf-layout
+static glb_chunks parse_glb(std::span<char const> data, std::filesystem::path const & path)
 {
-    rapidjson::Document document;
+    constexpr std::uint32_t glb_magic = 0x46546C67; // "glTF"
+    constexpr std::uint32_t json_chunk_type = 0x4E4F534A; // "JSON"
+    constexpr std::uint32_t bin_chunk_type = 0x004E4942; // "BIN\0"
 
+    auto read_u32 = [&](std::size_t offset)
     {
-        std::ifstream input(path, std::ios::binary);
-        rapidjson::IStreamWrapper stream(input);
-        document.ParseStream(stream);
+        std::uint32_t value;
+        std::memcpy(&value, data.data() + offset, sizeof(value));
+        return value;
+    };
+
+    if (data.size() < 12 || read_u32(0) != glb_magic)
+        throw std::runtime_error("Not a binary glTF file: " + path.string());
+    if (read_u32(4) != 2)
+        throw std::runtime_error("Unsupported binary glTF version in " + path.string());
+
+    std::size_t const length = std::min<std::size_t>(read_u32(8), data.size());
+
+    glb_chunks result;
+
+    for (std::size_t offset = 12; offset + 8 <= length;)
+    {
+        std::size_t const chunk_length = read_u32(offset);
+        std::uint32_t const chunk_type = read_u32(offset + 4);
+        offset += 8;
+
+        if (chunk_length > length - offset)
+            throw std::runtime_error("Truncated chunk in " + path.string());
+
+        auto const chunk = data.subspan(offset, chunk_length);
+        if (chunk_type == json_chunk_type && result.json.empty())
+            result.json = chunk;
+        else if (chunk_type == bin_chunk_type && result.bin.empty())
+            result.bin = chunk;
+
+        offset += chunk_length;
     }
 
+    if (result.json.empty())
+        throw std::runtime_error("No JSON chunk in " + path.string());
+
+    return result;
+}
+
+gltf_model load_gltf(std::filesystem::path const & path)
+{
     gltf_model result;
 
+    std::optional<json_document> document_storage;
+    std::span<char const> glb_bin;
+
+    if (path.extension() == ".glb")
     {
-        auto buffers = document["buffers"].GetArray();
-        assert(buffers.Size() == 1);
+        // A single mapping for both chunks; the JSON is copied once since the mapping is read-only
+        result.file = mapped_file(path, mapped_file::access::random);
+        auto const chunks = parse_glb({result.file.data(), result.file.size()}, path);
 
-        auto const buffer_uri = buffers[0]["uri"].GetString();
+        document_storage.emplace(chunks.json, path.string());
+        glb_bin = chunks.bin;
+    }
+    else
+        document_storage.emplace(path);
+
+    auto const & document = *document_storage;
 
-        auto const buffer_path = path.parent_path() / buffer_uri;
+    {
+        auto buffers = document["buffers"].GetArray();
+        assert(buffers.Size() == 1);
 
-        result.buffer.resize(std::filesystem::file_size(buffer_path));
-        std::ifstream buffer(buffer_path, std::ios::binary);
-        buffer.read(result.buffer.data(), result.buffer.size());
+        if (buffers[0].HasMember("uri"))
+        {
+            result.file = mapped_file(path.parent_path() / buffers[0]["uri"].GetString(), mapped_file::access::random);
+            result.buffer = {result.file.data(), result.file.size()};
+        }
+        else if (!glb_bin.empty())
+            result.buffer = glb_bin;
+        else
+            throw std::runtime_error("No binary buffer in " + path.string());
     }
 
-    auto parse_buffer_view = [&](int index) -> gltf_model::buffer_view
+    // Buffer views and accessors are resolved once into flat tables indexed like the JSON arrays
+
+    std::vector<gltf_model::buffer_view> buffer_views;
+    for (auto const & view : document["bufferViews"].GetArray())
     {
-        auto view = document["bufferViews"].GetArray()[index].GetObject();
-        return {view["byteOffset"].GetUint(), view["byteLength"].GetUint()};
-    };
+        buffer_views.push_back({
+            view.HasMember("byteOffset") ? view["byteOffset"].GetUint() : 0u,
+            view["byteLength"].GetUint(),
+            view.HasMember("byteStride") ? view["byteStride"].GetUint() : 0u,
+        });
+    }
 
-    auto parse_accessor = [&](int index) -> gltf_model::accessor
+    std::vector<gltf_model::accessor> accessors;
+    for (auto const & accessor : document["accessors"].GetArray())
     {
-        auto accessor = document["accessors"].GetArray()[index].GetObject();
-        return {
-            parse_buffer_view(accessor["bufferView"].GetInt()),
+        auto & result_accessor = accessors.emplace_back(gltf_model::accessor{
+            accessor.HasMember("bufferView") ? buffer_views.at(accessor["bufferView"].GetUint()) : gltf_model::buffer_view{0, 0},
             accessor["componentType"].GetUint(),
             attribute_type_to_size(accessor["type"].GetString()),
             accessor["count"].GetUint(),
-        };
+        });
+
+        if (accessor.HasMember("byteOffset"))
+        {
+            unsigned int const offset = accessor["byteOffset"].GetUint();
+            result_accessor.view.offset += offset;
+            result_accessor.view.size -= std::min(offset, result_accessor.view.size);
+        }
+    }
+
+    auto parse_accessor = [&](int index) -> gltf_model::accessor const &
+    {
+        return accessors.at(index);
+    };
+
+    auto parse_optional_accessor = [&](auto const & attributes, char const * name) -> gltf_model::accessor
+    {
+        if (!attributes.HasMember(name))
+            return {};
+        return parse_accessor(attributes[name].GetInt());
     };
 
-    auto parse_texture = [&](int index) -> std::string
+    // Images embedded into a buffer view (as in most .glb files) are not supported
+    auto parse_texture = [&](int index) -> std::optional<std::string>
     {
         auto const source_index = document["textures"].GetArray()[index]["source"].GetInt();
-        return document["images"].GetArray()[source_index]["uri"].GetString();
+        auto const & image = document["images"].GetArray()[source_index];
+        if (!image.HasMember("uri"))
+            return std::nullopt;
+        return image["uri"].GetString();
     };
 
     auto parse_color = [&](auto const & array)
@@ -74,147 +184,373 @@ gltf_model load_gltf(std::filesystem::path const & path)
         };
     };
 
-    for (auto const & mesh : document["meshes"].GetArray())
+    std::vector<gltf_model::material> materials;
+    if (document.HasMember("materials"))
+    {
+        for (auto const & material : document["materials"].GetArray())
+        {
+            auto & result_material = materials.emplace_back();
+
+            result_material.two_sided = material.HasMember("doubleSided") && material["doubleSided"].GetBool();
+            result_material.transparent = material.HasMember("alphaMode") && (material["alphaMode"].GetString() == std::string("BLEND"));
+
+            if (!material.HasMember("pbrMetallicRoughness"))
+                continue;
+
+            auto const & pbr = material["pbrMetallicRoughness"];
+            if (pbr.HasMember("baseColorTexture"))
+                result_material.texture_path = parse_texture(pbr["baseColorTexture"]["index"].GetInt());
+            if (!result_material.texture_path && pbr.HasMember("baseColorFactor"))
+                result_material.color = parse_color(pbr["baseColorFactor"].GetArray());
+        }
+    }
+
+    // Primitives of every glTF mesh are consecutive in result.meshes
+    std::vector<std::pair<unsigned int, unsigned int>> mesh_ranges;
+    if (document.HasMember("meshes"))
     {
-        auto & result_mesh = result.meshes.emplace_back();
-        result_mesh.name = mesh["name"].GetString();
+        for (auto const & mesh : document["meshes"].GetArray())
+        {
+            auto primitives = mesh["primitives"].GetArray();
+            mesh_ranges.emplace_back(result.meshes.size(), primitives.Size());
+
+            for (auto const & primitive : primitives)
+            {
+                auto & result_mesh = result.meshes.emplace_back();
+                result_mesh.name = mesh.HasMember("name") ? mesh["name"].GetString() : "";
+
+                auto const & attributes = primitive["attributes"];
+
+                if (primitive.HasMember("mode"))
+                    result_mesh.mode = primitive["mode"].GetUint();
+                if (primitive.HasMember("indices"))
+                    result_mesh.indices = parse_accessor(primitive["indices"].GetInt());
+                result_mesh.position = parse_accessor(attributes["POSITION"].GetInt());
+                result_mesh.normal = parse_optional_accessor(attributes, "NORMAL");
+                result_mesh.texcoord = parse_optional_accessor(attributes, "TEXCOORD_0");
+                result_mesh.joints = parse_optional_accessor(attributes, "JOINTS_0");
+                result_mesh.weights = parse_optional_accessor(attributes, "WEIGHTS_0");
+
+                if (primitive.HasMember("material"))
+                    result_mesh.material = materials.at(primitive["material"].GetUint());
+            }
+        }
+    }
+
+    if (!document.HasMember("nodes"))
+        return result;
+
+    auto nodes = document["nodes"].GetArray();
 
-        auto primitives = mesh["primitives"].GetArray();
-        assert(primitives.Size() == 1);
+    // The hierarchy is flattened depth-first from the roots of the scene, then from
+    // any other roots (e.g. skeletons outside the scene), so parents precede children
 
-        auto const & attributes = primitives[0]["attributes"];
+    std::vector<unsigned int> node_parents(nodes.Size(), -1);
+    for (unsigned int i = 0; i < nodes.Size(); ++i)
+    {
+        if (!nodes[i].HasMember("children")) continue;
 
-        result_mesh.indices = parse_accessor(primitives[0]["indices"].GetInt());
-        result_mesh.position = parse_accessor(attributes["POSITION"].GetInt());
-        result_mesh.normal = parse_accessor(attributes["NORMAL"].GetInt());
-        result_mesh.texcoord = parse_accessor(attributes["TEXCOORD_0"].GetInt());
-        result_mesh.joints = parse_accessor(attributes["JOINTS_0"].GetInt());
-        result_mesh.weights = parse_accessor(attributes["WEIGHTS_0"].GetInt());
+        for (auto const & child : nodes[i]["children"].GetArray())
+            node_parents.at(child.GetUint()) = i;
+    }
 
-        auto const & material = document["materials"].GetArray()[primitives[0]["material"].GetInt()];
+    std::vector<unsigned int> roots;
+    if (document.HasMember("scenes"))
+    {
+        auto scenes = document["scenes"].GetArray();
+        unsigned int const scene = document.HasMember("scene") ? document["scene"].GetUint() : 0u;
+        if (scene < scenes.Size() && scenes[scene].HasMember("nodes"))
+            for (auto const & root : scenes[scene]["nodes"].GetArray())
+                roots.push_back(root.GetUint());
+    }
+    for (unsigned int i = 0; i < nodes.Size(); ++i)
+        if (node_parents[i] == -1 && std::find(roots.begin(), roots.end(), i) == roots.end())
+            roots.push_back(i);
+
+    // Node index in the file -> index in result.nodes
+    std::vector<unsigned int> node_index(nodes.Size(), -1);
+    std::vector<unsigned int> node_order;
+    node_order.reserve(nodes.Size());
+    {
+        std::vector<unsigned int> stack;
+        for (unsigned int root : roots)
+        {
+            stack.push_back(root);
+            while (!stack.empty())
+            {
+                unsigned int const i = stack.back();
+                stack.pop_back();
+                if (node_index[i] != -1)
+                    throw std::runtime_error("Node " + std::to_string(i) + " has several parents in " + path.string());
 
-        result_mesh.material.two_sided = material.HasMember("doubleSided") && material["doubleSided"].GetBool();
-        result_mesh.material.transparent = material.HasMember("alphaMode") && (material["alphaMode"].GetString() == std::string("BLEND"));
+                node_index[i] = node_order.size();
+                node_order.push_back(i);
 
-        auto const & pbr = material["pbrMetallicRoughness"];
-        if (pbr.HasMember("baseColorTexture"))
-            result_mesh.material.texture_path = parse_texture(pbr["baseColorTexture"]["index"].GetInt());
-        else if (pbr.HasMember("baseColorFactor"))
-            result_mesh.material.color = parse_color(pbr["baseColorFactor"].GetArray());
+                if (!nodes[i].HasMember("children")) continue;
+
+                // Reversed, so that children come out of the stack in their order
+                auto children = nodes[i]["children"].GetArray();
+                for (auto child = children.End(); child != children.Begin();)
+                    stack.push_back((--child)->GetUint());
+            }
+        }
     }
 
-    auto skins = document["skins"].GetArray();
-    assert(skins.Size() == 1);
+    std::vector<bool> node_targeted(nodes.Size(), false);
+    if (document.HasMember("animations"))
+    {
+        for (auto const & animation : document["animations"].GetArray())
+            for (auto const & channel : animation["channels"].GetArray())
+                if (channel["target"].HasMember("node"))
+                    node_targeted.at(channel["target"]["node"].GetUint()) = true;
+    }
 
+    auto parse_transform = [&](auto const & node)
     {
-        auto fill_buffer = [&](auto & vector, gltf_model::accessor const & accessor)
+        glm::mat4 transform(1.f);
+
+        if (node.HasMember("matrix"))
         {
-            assert(accessor.type == 0x1406); // GL_FLOAT
-            using value_type = std::decay_t<decltype(vector[0])>;
-            auto begin = reinterpret_cast<value_type const *>(result.buffer.data() + accessor.view.offset);
-            vector.assign(begin, begin + accessor.count);
-        };
+            auto matrix = node["matrix"].GetArray();
+            for (int i = 0; i < 16; ++i)
+                transform[i / 4][i % 4] = matrix[i].GetFloat();
+            return transform;
+        }
 
-        auto fix_rotations = [](std::vector<glm::quat> & rotations)
+        if (node.HasMember("translation"))
         {
-            for (auto & r : rotations)
-                r = glm::quat(r.z, r.w, r.x, r.y);
-        };
+            auto t = node["translation"].GetArray();
+            transform = glm::translate(transform, {t[0].GetFloat(), t[1].GetFloat(), t[2].GetFloat()});
+        }
+        if (node.HasMember("rotation"))
+        {
+            auto r = node["rotation"].GetArray();
+            transform = transform * glm::toMat4(glm::quat(r[3].GetFloat(), r[0].GetFloat(), r[1].GetFloat(), r[2].GetFloat()));
+        }
+        if (node.HasMember("scale"))
+        {
+            auto s = node["scale"].GetArray();
+            transform = glm::scale(transform, {s[0].GetFloat(), s[1].GetFloat(), s[2].GetFloat()});
+        }
+        return transform;
+    };
 
-        auto joints = skins[0]["joints"].GetArray();
+    result.nodes.resize(node_order.size());
+    for (unsigned int n = 0; n < node_order.size(); ++n)
+    {
+        auto const & node = nodes[node_order[n]];
+        auto & result_node = result.nodes[n];
 
-        std::vector<glm::mat4> inverse_bind_matrices(joints.Size());
-        fill_buffer(inverse_bind_matrices, parse_accessor(skins[0]["inverseBindMatrices"].GetInt()));
+        if (node.HasMember("name"))
+            result_node.name = node["name"].GetString();
 
-        result.bones.resize(joints.Size());
+        result_node.transform = parse_transform(node);
+        result_node.animated = node_targeted[node_order[n]];
 
-        std::unordered_map<int, int> bone_node_to_index;
-        for (int i = 0; i < joints.Size(); ++i)
+        if (unsigned int const parent = node_parents[node_order[n]]; parent != -1)
         {
-            int const node_id = joints[i].GetInt();
-            bone_node_to_index[node_id] = i;
-            result.bones[i].name = document["nodes"].GetArray()[node_id]["name"].GetString();
-            result.bones[i].inverse_bind_matrix = inverse_bind_matrices[i];
+            result_node.parent = node_index[parent];
+            auto const & parent_node = result.nodes[result_node.parent];
+            result_node.world = parent_node.world * result_node.transform;
+            result_node.animated = result_node.animated || parent_node.animated;
         }
+        else
+            result_node.world = result_node.transform;
 
-        auto nodes = document["nodes"].GetArray();
+        if (node.HasMember("mesh"))
+            std::tie(result_node.first_mesh, result_node.mesh_count) = mesh_ranges.at(node["mesh"].GetUint());
+        if (node.HasMember("skin"))
+            result_node.skin = node["skin"].GetUint();
+    }
 
-        for (int i = 0; i < nodes.Size(); ++i)
-        {
-            if (!bone_node_to_index.contains(i)) continue;
+    auto fill_span = [&](auto & span, gltf_model::accessor const & accessor)
+    {
+        assert(accessor.type == 0x1406); // GL_FLOAT
+        using value_type = std::decay_t<decltype(span[0])>;
+        span = result.accessor_data<value_type>(accessor);
+    };
+
+    // Index in result.nodes -> index in result.bones
+    std::vector<unsigned int> node_bone(result.nodes.size(), -1);
+
+    if (document.HasMember("skins"))
+    {
+        auto skins = document["skins"].GetArray();
 
-            auto const & node = nodes[i];
+        std::vector<bool> is_joint(result.nodes.size(), false);
+        for (auto const & skin : skins)
+            for (auto const & joint : skin["joints"].GetArray())
+                is_joint[node_index.at(joint.GetUint())] = true;
 
-            if (!node.HasMember("children")) continue;
+        // The nearest ancestor that is a joint
+        auto parent_joint = [&](unsigned int n)
+        {
+            do
+                n = result.nodes[n].parent;
+            while (n != -1 && !is_joint[n]);
+            return n;
+        };
+
+        // The first skin's joints in their order if that puts parents first,
+        // otherwise in hierarchy order; then the other skins' in hierarchy order
+        std::vector<unsigned int> bone_nodes;
+        for (auto const & joint : skins[0]["joints"].GetArray())
+        {
+            unsigned int const n = node_index.at(joint.GetUint());
+            if (node_bone[n] != -1) continue;
 
-            for (auto const & child : node["children"].GetArray())
+            unsigned int const parent = parent_joint(n);
+            if (parent != -1 && node_bone[parent] == -1)
             {
-                int child_id = child.GetInt();
-                if (bone_node_to_index.contains(child_id))
-                    result.bones[bone_node_to_index.at(child_id)].parent = bone_node_to_index.at(i);
+                bone_nodes.clear();
+                std::fill(node_bone.begin(), node_bone.end(), -1);
+                break;
             }
+
+            node_bone[n] = bone_nodes.size();
+            bone_nodes.push_back(n);
         }
+        for (unsigned int n = 0; n < result.nodes.size(); ++n)
+        {
+            if (!is_joint[n] || node_bone[n] != -1) continue;
 
-        for (int i = 0; i < result.bones.size(); ++i)
-            assert(result.bones[i].parent == -1 || result.bones[i].parent < i);
+            node_bone[n] = bone_nodes.size();
+            bone_nodes.push_back(n);
+        }
 
-        for (auto const & animation : document["animations"].GetArray())
+        result.bones.resize(bone_nodes.size());
+        for (unsigned int b = 0; b < bone_nodes.size(); ++b)
         {
-            std::string name = animation["name"].GetString();
+            auto & bone = result.bones[b];
+            bone.node = bone_nodes[b];
+            bone.name = result.nodes[bone.node].name;
+            decompose_transform(result.nodes[bone.node].transform, bone.translation, bone.rotation, bone.scale);
 
-            auto samplers = animation["samplers"].GetArray();
+            if (unsigned int const parent = parent_joint(bone.node); parent != -1)
+                bone.parent = node_bone[parent];
 
-            gltf_model::animation result_animation;
-            result_animation.bones.resize(result.bones.size());
+            assert(bone.parent == -1 || bone.parent < b);
+        }
 
-            for (auto const & channel : animation["channels"].GetArray())
+        for (auto const & skin : skins)
+        {
+            auto & result_skin = result.skins.emplace_back();
+            if (skin.HasMember("name"))
+                result_skin.name = skin["name"].GetString();
+
+            auto joints = skin["joints"].GetArray();
+            for (auto const & joint : joints)
+                result_skin.joints.push_back(node_bone[node_index.at(joint.GetUint())]);
+
+            // Identity matrices when the skin doesn't have them
+            result_skin.inverse_bind_matrices.assign(joints.Size(), glm::mat4(1.f));
+            if (skin.HasMember("inverseBindMatrices"))
             {
-                int node_id = channel["target"]["node"].GetInt();
-                if (!bone_node_to_index.contains(node_id)) continue;
+                std::span<glm::mat4 const> inverse_bind_matrices;
+                fill_span(inverse_bind_matrices, parse_accessor(skin["inverseBindMatrices"].GetInt()));
+                std::copy_n(inverse_bind_matrices.begin(), std::min<std::size_t>(joints.Size(), inverse_bind_matrices.size()),
+                    result_skin.inverse_bind_matrices.begin());
+            }
+        }
+    }
 
-                auto & bone = result_animation.bones[bone_node_to_index.at(node_id)];
+    if (!document.HasMember("animations"))
+        return result;
 
-                std::string path = channel["target"]["path"].GetString();
+    for (auto const & animation : document["animations"].GetArray())
+    {
+        std::string name = animation.HasMember("name") ? animation["name"].GetString() : "";
 
-                auto const & sampler = samplers[channel["sampler"].GetInt()];
+        auto samplers = animation["samplers"].GetArray();
 
-                auto input = parse_accessor(sampler["input"].GetInt());
-                auto output = parse_accessor(sampler["output"].GetInt());
+        gltf_model::animation result_animation;
+        result_animation.bones.resize(result.bones.size());
+        for (std::size_t b = 0; b < result.bones.size(); ++b)
+        {
+            auto & bone = result_animation.bones[b];
+            bone.rest_translation = result.bones[b].translation;
+            bone.rest_rotation = result.bones[b].rotation;
+            bone.rest_scale = result.bones[b].scale;
+        }
 
-                if (path == "translation")
-                {
-                    fill_buffer(bone.translation.timestamps, input);
-                    fill_buffer(bone.translation.values, output);
-                }
-                else if (path == "rotation")
-                {
-                    fill_buffer(bone.rotation.timestamps, input);
-                    fill_buffer(bone.rotation.values, output);
-                    fix_rotations(bone.rotation.values);
-                }
-                else if (path == "scale")
+        for (auto const & channel : animation["channels"].GetArray())
+        {
+            if (!channel["target"].HasMember("node")) continue;
+
+            unsigned int const node_id = node_index.at(channel["target"]["node"].GetUint());
+
+            gltf_model::bone_animation * target;
+            if (node_bone[node_id] != -1)
+                target = &result_animation.bones[node_bone[node_id]];
+            else
+            {
+                auto node_animation = std::find_if(result_animation.nodes.begin(), result_animation.nodes.end(),
+                    [&](auto const & node_animation){ return node_animation.node == node_id; });
+                if (node_animation != result_animation.nodes.end())
+                    target = &node_animation->transform;
+                else
                 {
-                    fill_buffer(bone.scale.timestamps, input);
-                    fill_buffer(bone.scale.values, output);
+                    target = &result_animation.nodes.emplace_back(gltf_model::node_animation{node_id, {}}).transform;
+                    decompose_transform(result.nodes[node_id].transform, target->rest_translation, target->rest_rotation, target->rest_scale);
                 }
             }
 
-            auto update_max_time = [&](std::vector<float> const & timestamps)
+            auto & bone = *target;
+
+            std::string path = channel["target"]["path"].GetString();
+
+            auto const & sampler = samplers[channel["sampler"].GetInt()];
+
+            auto input = parse_accessor(sampler["input"].GetInt());
+            auto output = parse_accessor(sampler["output"].GetInt());
+
+            if (path == "translation")
             {
+                fill_span(bone.translation.timestamps, input);
+                fill_span(bone.translation.values, output);
+            }
+            else if (path == "rotation")
+            {
+                fill_span(bone.rotation.timestamps, input);
+                fill_span(bone.rotation.values, output);
+            }
+            else if (path == "scale")
+            {
+                fill_span(bone.scale.timestamps, input);
+                fill_span(bone.scale.values, output);
+            }
+        }
+
+        auto update_max_time = [&](gltf_model::bone_animation const & bone)
+        {
+            for (auto timestamps : {bone.translation.timestamps, bone.rotation.timestamps, bone.scale.timestamps})
                 for (float t : timestamps)
                     result_animation.max_time = std::max(result_animation.max_time, t);
-            };
+        };
 
-            for (auto const & bone : result_animation.bones)
-            {
-                update_max_time(bone.translation.timestamps);
-                update_max_time(bone.rotation.timestamps);
-                update_max_time(bone.scale.timestamps);
-            }
+        for (auto const & bone : result_animation.bones)
+            update_max_time(bone);
+        for (auto const & node : result_animation.nodes)
+            update_max_time(node.transform);
 
-            result.animations[std::move(name)] = std::move(result_animation);
-        }
+        result.animations[std::move(name)] = std::move(result_animation);
     }
 
     return result;
 }
+
+unsigned int drawn_skin(gltf_model const & model)
+{
+    if (model.skins.empty())
+        throw std::runtime_error("The model has no skins");
+
+    unsigned int result = -1;
+    for (auto const & node : model.nodes)
+    {
+        if (node.skin == -1 || node.mesh_count == 0 || node.skin == result) continue;
+        if (result != -1)
+            throw std::runtime_error("Meshes bound to several skins are not supported");
+        result = node.skin;
+    }
+    return (result == -1) ? 0 : result;
+}
@@ -0,0 +1,108 @@
+#include "gltf_loader.hpp"
+#include "json_document.hpp"
+
+#include <rapidjson/document.h>
+#include <rapidjson/istreamwrapper.h>
+
+#include <iostream>
+#include <fstream>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <algorithm>
+
+// Usage: gltf_loader_benchmark [--iterations N] file.gltf...
+// Compares parsing the JSON of each file through an ifstream wrapper into a
+// default rapidjson::Document (how the loaders used to do it) with the in-situ
+// json_document, and times the whole load_gltf on top of that.
+
+namespace
+{
+
+    struct timing
+    {
+        double best = 1e30;
+        double total = 0.0;
+    };
+
+    template <typename Function>
+    timing measure(int iterations, Function && function)
+    {
+        timing result;
+        for (int i = 0; i < iterations; ++i)
+        {
+            auto start = std::chrono::high_resolution_clock::now();
+            function();
+            auto end = std::chrono::high_resolution_clock::now();
+
+            double const time = std::chrono::duration_cast<std::chrono::duration<double>>(end - start).count();
+            result.best = std::min(result.best, time);
+            result.total += time;
+        }
+        return result;
+    }
+
+    void print(char const * name, timing const & time, int iterations)
+    {
+        std::cout << "    " << name << time.best * 1000.0 << " ms best, " << time.total * 1000.0 / iterations << " ms mean\n";
+    }
+
+}
+
+int main(int argc, char ** argv) try
+{
+    int iterations = 10;
+    std::vector<std::filesystem::path> paths;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (argv[i] == std::string("--iterations") && i + 1 < argc)
+            iterations = std::max(1, std::atoi(argv[++i]));
+        else
+            paths.push_back(argv[i]);
+    }
+
+    if (paths.empty())
+    {
+        std::cerr << "Usage: " << argv[0] << " [--iterations N] file.gltf..." << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::size_t checksum = 0;
+
+    for (auto const & path : paths)
+    {
+        auto const stream_parse = measure(iterations, [&]{
+            rapidjson::Document document;
+            std::ifstream input(path, std::ios::binary);
+            rapidjson::IStreamWrapper stream(input);
+            document.ParseStream(stream);
+            if (document.HasParseError())
+                throw std::runtime_error("Failed to parse " + path.string());
+            checksum += document.MemberCount();
+        });
+
+        auto const in_situ_parse = measure(iterations, [&]{
+            json_document const document(path);
+            checksum += document.root().MemberCount();
+        });
+
+        auto const load = measure(iterations, [&]{
+            auto const model = load_gltf(path);
+            checksum += model.meshes.size() + model.bones.size() + model.animations.size();
+        });
+
+        std::cout << path.string() << " (" << std::filesystem::file_size(path) << " bytes)\n";
+        print("stream parse:   ", stream_parse, iterations);
+        print("in-situ parse:  ", in_situ_parse, iterations);
+        print("load_gltf:      ", load, iterations);
+    }
+
+    std::cout << "checksum: " << checksum << std::endl;
+}
+catch (std::exception const & e)
+{
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,88 @@
+#include "gltf_skinning.hpp"
+
+#include <stdexcept>
+
+namespace
+{
+
+    // Component types, see https://registry.khronos.org/glTF/specs/2.0/glTF-2.0.html#accessor-data-types
+    constexpr unsigned int gl_unsigned_byte = 0x1401;
+    constexpr unsigned int gl_unsigned_short = 0x1403;
+    constexpr unsigned int gl_float = 0x1406;
+
+    template <typename T>
+    void read_vec4(gltf_model const & model, gltf_model::accessor const & accessor, float scale, auto && store)
+    {
+        auto const data = model.attribute_data<std::array<T, 4>>(accessor);
+        for (std::size_t i = 0; i < data.size(); ++i)
+        {
+            auto const value = data[i];
+            store(i, glm::vec4(value[0], value[1], value[2], value[3]) * scale);
+        }
+    }
+
+}
+
+skinning_mesh make_skinning_mesh(gltf_model const & model, gltf_model::mesh const & mesh)
+{
+    if (mesh.position.type != gl_float || (mesh.normal.count != 0 && mesh.normal.type != gl_float))
+        throw std::runtime_error("Unsupported position or normal type in mesh " + mesh.name);
+
+    skinning_mesh result;
+
+    auto const positions = model.attribute_data<glm::vec3>(mesh.position);
+    result.positions.resize(positions.size());
+    for (std::size_t i = 0; i < positions.size(); ++i)
+        result.positions[i] = positions[i];
+
+    std::size_t const size = result.positions.size();
+
+    // Meshes without normals get zero ones, which skin to zero
+    if (mesh.normal.count == size)
+    {
+        auto const normals = model.attribute_data<glm::vec3>(mesh.normal);
+        result.normals.resize(size);
+        for (std::size_t i = 0; i < size; ++i)
+            result.normals[i] = normals[i];
+    }
+    else
+        result.normals.assign(size, glm::vec3(0.f));
+
+    result.joints.assign(size, {0, 0, 0, 0});
+    result.weights.assign(size, glm::vec4(1.f, 0.f, 0.f, 0.f));
+
+    if (mesh.joints.count == 0 || mesh.weights.count == 0)
+        return result;
+
+    if (mesh.joints.count != size || mesh.weights.count != size)
+        throw std::runtime_error("Mismatched skinning attributes in mesh " + mesh.name);
+
+    auto store_joints = [&](std::size_t i, glm::vec4 const & joints)
+    {
+        for (int k = 0; k < 4; ++k)
+            result.joints[i][k] = static_cast<std::uint16_t>(joints[k]);
+    };
+
+    if (mesh.joints.type == gl_unsigned_byte)
+        read_vec4<std::uint8_t>(model, mesh.joints, 1.f, store_joints);
+    else if (mesh.joints.type == gl_unsigned_short)
+        read_vec4<std::uint16_t>(model, mesh.joints, 1.f, store_joints);
+    else
+        throw std::runtime_error("Unsupported joints type in mesh " + mesh.name);
+
+    auto store_weights = [&](std::size_t i, glm::vec4 const & weights)
+    {
+        result.weights[i] = weights;
+    };
+
+    if (mesh.weights.type == gl_float)
+        read_vec4<float>(model, mesh.weights, 1.f, store_weights);
+    else if (mesh.weights.type == gl_unsigned_byte)
+        read_vec4<std::uint8_t>(model, mesh.weights, 1.f / 255.f, store_weights);
+    else if (mesh.weights.type == gl_unsigned_short)
+        read_vec4<std::uint16_t>(model, mesh.weights, 1.f / 65535.f, store_weights);
+    else
+        throw std::runtime_error("Unsupported weights type in mesh " + mesh.name);
+
+    return result;
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+#include "gltf_loader.hpp"
+#include "cpu_skinning.hpp"
+
+// Reads POSITION, NORMAL, JOINTS_0 and WEIGHTS_0 of a glTF mesh. Joints may be unsigned
+// bytes or shorts, weights floats or normalized unsigned bytes or shorts.
+// The joints index the palette of the skin of the mesh's node (see skeleton_evaluator);
+// a mesh without joints is bound entirely to its joint 0.
+skinning_mesh make_skinning_mesh(gltf_model const & model, gltf_model::mesh const & mesh);
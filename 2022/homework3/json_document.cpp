@@ -0,0 +1,61 @@
+#include "json_document.hpp"
+
+#include <rapidjson/error/en.h>
+
+#include <fstream>
+#include <stdexcept>
+
+namespace
+{
+
+    // In-situ values take about two bytes of DOM per byte of text
+    std::size_t arena_size(std::size_t text_size)
+    {
+        return 2 * text_size + 64 * 1024;
+    }
+
+    std::vector<char> read_text(std::filesystem::path const & path)
+    {
+        std::ifstream input(path, std::ios::binary);
+        if (!input)
+            throw std::runtime_error("Failed to open " + path.string());
+
+        std::vector<char> result(std::filesystem::file_size(path) + 1, '\0');
+        input.read(result.data(), result.size() - 1);
+        if (!input)
+            throw std::runtime_error("Failed to read " + path.string());
+
+        return result;
+    }
+
+    std::vector<char> copy_text(std::span<char const> text)
+    {
+        std::vector<char> result;
+        result.reserve(text.size() + 1);
+        result.assign(text.begin(), text.end());
+        result.push_back('\0');
+        return result;
+    }
+
+}
+
+json_document::json_document(std::filesystem::path const & path)
+    : json_document(read_text(path), path.string())
+{}
+
+json_document::json_document(std::span<char const> text, std::string const & name)
+    : json_document(copy_text(text), name)
+{}
+
+json_document::json_document(std::vector<char> && text, std::string const & name)
+    : text_(std::move(text))
+    , arena_(arena_size(text_.size()))
+    , allocator_(arena_.data(), arena_.size())
+    , document_(&allocator_)
+{
+    document_.ParseInsitu(text_.data());
+
+    if (document_.HasParseError())
+        throw std::runtime_error("Failed to parse " + name + ": " + rapidjson::GetParseError_En(document_.GetParseError())
+            + " at offset " + std::to_string(document_.GetErrorOffset()));
+}
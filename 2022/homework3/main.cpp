@@ -16,6 +16,7 @@
 #include <map>
 #include <cmath>
 #include <thread>
+#include <cstdlib>
 
 #define GLM_FORCE_SWIZZLE
 #define GLM_ENABLE_EXPERIMENTAL
@@ -27,6 +28,9 @@
 #include <glm/gtx/string_cast.hpp>
 
 #include "gltf_loader.hpp"
+#include "baked_animation.hpp"
+#include "crowd_animation.hpp"
+#include "worker_pool.hpp"
 #include "obj_parser.hpp"
 #include "stb_image.h"
 
@@ -118,8 +122,16 @@ glm::mat4 rotation_matrix(glm::vec3 camera_rotation) {
     return view;
 }
 
-int main() try
+int main(int argc, char ** argv) try
 {
+    // With --crowd N, N characters dance on a grid, each from its own point of the animation
+    std::size_t crowd_size = 1;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (argv[i] == std::string("--crowd") && i + 1 < argc)
+            crowd_size = std::max(1, std::atoi(argv[++i]));
+    }
+
     if (SDL_Init(SDL_INIT_VIDEO) != 0)
         sdl2_fail("SDL_Init: ");
 
@@ -198,6 +210,7 @@ int main() try
     GLuint shadow_projection_location = glGetUniformLocation(shadow_program, "shadow_projection");
     GLuint shadow_use_bones_location = glGetUniformLocation(shadow_program, "use_bones");
     GLuint shadow_bones_location = glGetUniformLocation(shadow_program, "bones");
+    GLuint shadow_bone_count_location = glGetUniformLocation(shadow_program, "bone_count");
 
     // WOLF
 
@@ -215,6 +228,7 @@ int main() try
     GLuint wolf_camera_position_location = glGetUniformLocation(wolf_program, "camera_position");
     GLuint wolf_position_location = glGetUniformLocation(wolf_program, "position");
     GLuint wolf_bones_location = glGetUniformLocation(wolf_program, "bones");
+    GLuint wolf_bone_count_location = glGetUniformLocation(wolf_program, "bone_count");
     GLuint wolf_mist_radius_location = glGetUniformLocation(wolf_program, "mist_radius");
     GLuint wolf_mist_center_location = glGetUniformLocation(wolf_program, "mist_center");
     GLuint wolf_mist_color_location = glGetUniformLocation(wolf_program, "mist_color");
@@ -339,11 +353,45 @@ int main() try
     // WOLF
     const std::string wolf_model_path = project_root + "/Macarena/Macarena.gltf"; //"/wolf/Wolf-Blender-2.82a.gltf";
     auto const wolf_input_model = load_gltf(wolf_model_path);
+    auto const macarena_animation = bake_animation((*wolf_input_model.animations.begin()).second);
+    worker_pool workers;
+    crowd_animation crowd(wolf_input_model.bones, wolf_input_model.skins[drawn_skin(wolf_input_model)],
+        macarena_animation, crowd_size, workers.size());
     GLuint wolf_vbo;
     glGenBuffers(1, &wolf_vbo);
     glBindBuffer(GL_ARRAY_BUFFER, wolf_vbo);
     glBufferData(GL_ARRAY_BUFFER, wolf_input_model.buffer.size(), wolf_input_model.buffer.data(), GL_STATIC_DRAW);
 
+    // Character positions on a square grid centered at the origin
+    std::vector<glm::vec3> crowd_offsets(crowd_size);
+    {
+        float const spacing = 0.6f;
+        std::size_t const columns = std::ceil(std::sqrt(static_cast<float>(crowd_size)));
+        std::size_t const rows = (crowd_size + columns - 1) / columns;
+        for (std::size_t i = 0; i < crowd_size; ++i)
+        {
+            crowd_offsets[i].x = ((i % columns) - (columns - 1) / 2.f) * spacing;
+            crowd_offsets[i].z = ((i / columns) - (rows - 1) / 2.f) * spacing;
+        }
+    }
+
+    GLuint wolf_instance_vbo;
+    glGenBuffers(1, &wolf_instance_vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, wolf_instance_vbo);
+    glBufferData(GL_ARRAY_BUFFER, crowd_offsets.size() * sizeof(glm::vec3), crowd_offsets.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, wolf_vbo);
+
+    // The bone matrices of the whole crowd, refilled every frame
+    GLuint wolf_bones_buffer;
+    glGenBuffers(1, &wolf_bones_buffer);
+    glBindBuffer(GL_TEXTURE_BUFFER, wolf_bones_buffer);
+    glBufferData(GL_TEXTURE_BUFFER, crowd.palettes().size_bytes(), nullptr, GL_STREAM_DRAW);
+
+    GLuint wolf_bones_texture;
+    glGenTextures(1, &wolf_bones_texture);
+    glBindTexture(GL_TEXTURE_BUFFER, wolf_bones_texture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, wolf_bones_buffer);
+
     struct mesh
     {
         GLuint vao;
@@ -353,11 +401,15 @@ int main() try
 
     auto setup_attribute = [](int index, gltf_model::accessor const & accessor, bool integer = false)
     {
+        // Absent attributes are left disabled and read as the constant (0, 0, 0, 1)
+        if (accessor.count == 0)
+            return;
+
         glEnableVertexAttribArray(index);
         if (integer)
-            glVertexAttribIPointer(index, accessor.size, accessor.type, 0, reinterpret_cast<void *>(accessor.view.offset));
+            glVertexAttribIPointer(index, accessor.size, accessor.type, accessor.view.stride, reinterpret_cast<void *>(accessor.view.offset));
         else
-            glVertexAttribPointer(index, accessor.size, accessor.type, GL_FALSE, 0, reinterpret_cast<void *>(accessor.view.offset));
+            glVertexAttribPointer(index, accessor.size, accessor.type, GL_FALSE, accessor.view.stride, reinterpret_cast<void *>(accessor.view.offset));
     };
 
     std::vector<mesh> meshes;
@@ -376,6 +428,12 @@ int main() try
         setup_attribute(3, mesh.joints, true);
         setup_attribute(4, mesh.weights);
 
+        glBindBuffer(GL_ARRAY_BUFFER, wolf_instance_vbo);
+        glEnableVertexAttribArray(5);
+        glVertexAttribPointer(5, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
+        glVertexAttribDivisor(5, 1);
+        glBindBuffer(GL_ARRAY_BUFFER, wolf_vbo);
+
         result.material = mesh.material;
     }
 
@@ -641,31 +699,19 @@ int main() try
 
         // WOLF
         {
-            std::vector<glm::mat4x3> bones(wolf_input_model.bones.size(), glm::mat4x3(1));
-
-            auto macarena_animation = (*wolf_input_model.animations.begin()).second;
-
             float macarena_time = 9.348;
 
-            float slow_factor = macarena_animation.max_time / macarena_time;
-
-            auto run_frame = std::fmod(time * slow_factor, macarena_animation.max_time);
+            float slow_factor = macarena_animation.duration / macarena_time;
 
-            for (int bone_index = 0; bone_index < wolf_input_model.bones.size(); bone_index++) {
-                auto translation = glm::translate(glm::mat4(1.f), macarena_animation.bones[bone_index].translation(run_frame));
+            crowd.update(time * slow_factor, workers);
 
-                auto rotation = glm::toMat4(macarena_animation.bones[bone_index].rotation(run_frame));
+            // Orphan the previous frame's matrices instead of waiting for the draws that read them
+            glBindBuffer(GL_TEXTURE_BUFFER, wolf_bones_buffer);
+            glBufferData(GL_TEXTURE_BUFFER, crowd.palettes().size_bytes(), crowd.palettes().data(), GL_STREAM_DRAW);
 
-                auto scale = glm::scale(glm::mat4(1.f), macarena_animation.bones[bone_index].scale(run_frame));
-                glm::mat4 transform = translation * rotation * scale;
-                bones[bone_index] = transform;
-                if (wolf_input_model.bones[bone_index].parent != -1) {
-                    bones[bone_index] = bones[wolf_input_model.bones[bone_index].parent] * transform;
-                }
-            }
-            for (int bone_index = 0; bone_index < wolf_input_model.bones.size(); bone_index++) {
-                bones[bone_index] = bones[bone_index] * wolf_input_model.bones[bone_index].inverse_bind_matrix;
-            }
+            glActiveTexture(GL_TEXTURE2);
+            glBindTexture(GL_TEXTURE_BUFFER, wolf_bones_texture);
+            glActiveTexture(GL_TEXTURE0);
 
             auto draw_meshes = [&](bool transparent) {
                 for (auto const &mesh: meshes) {
@@ -692,8 +738,8 @@ int main() try
                         continue;
 
                     glBindVertexArray(mesh.vao);
-                    glDrawElements(GL_TRIANGLES, mesh.indices.count, mesh.indices.type,
-                                   reinterpret_cast<void *>(mesh.indices.view.offset));
+                    glDrawElementsInstanced(GL_TRIANGLES, mesh.indices.count, mesh.indices.type,
+                                            reinterpret_cast<void *>(mesh.indices.view.offset), crowd.instance_count());
                 }
             };
 
@@ -709,8 +755,8 @@ int main() try
                 glUniform1f(shadow_use_bones_location, 1);
                 glUniformMatrix4fv(shadow_projection_location, 1, GL_FALSE,
                                    reinterpret_cast<float *>(&light_projection));
-                glUniformMatrix4x3fv(shadow_bones_location, wolf_input_model.bones.size(), GL_FALSE,
-                                     reinterpret_cast<float *>(bones.data()));
+                glUniform1i(shadow_bones_location, 2);
+                glUniform1i(shadow_bone_count_location, crowd.palette_size());
                 glCullFace(GL_BACK);
 
                 draw_meshes(false);
@@ -749,8 +795,8 @@ int main() try
                 glUniformMatrix4fv(wolf_projection_location, 1, GL_FALSE, reinterpret_cast<float *>(&projection));
                 glUniform3fv(wolf_light_direction_location, 1, reinterpret_cast<float *>(&light_direction));
                 glUniform3fv(wolf_camera_position_location, 1, reinterpret_cast<float *>(&camera_position));
-                glUniformMatrix4x3fv(wolf_bones_location, wolf_input_model.bones.size(), GL_FALSE,
-                                     reinterpret_cast<float *>(bones.data()));
+                glUniform1i(wolf_bones_location, 2);
+                glUniform1i(wolf_bone_count_location, crowd.palette_size());
                 glUniformMatrix4fv(wolf_shadow_projection_location, 1, GL_FALSE,
                                    reinterpret_cast<float *>(&light_projection));
                 glUniform1i(wolf_shadow_map_location, 1);
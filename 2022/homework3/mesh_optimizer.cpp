@@ -0,0 +1,294 @@
+#include "mesh_optimizer.hpp"
+
+#include <algorithm>
+#include <numeric>
+#include <array>
+#include <cmath>
+
+namespace
+{
+
+    using vec3 = std::array<float, 3>;
+
+    vec3 operator - (vec3 const & a, vec3 const & b)
+    {
+        return {a[0] - b[0], a[1] - b[1], a[2] - b[2]};
+    }
+
+    vec3 & operator += (vec3 & a, vec3 const & b)
+    {
+        a[0] += b[0];
+        a[1] += b[1];
+        a[2] += b[2];
+        return a;
+    }
+
+    vec3 operator * (vec3 const & a, float s)
+    {
+        return {a[0] * s, a[1] * s, a[2] * s};
+    }
+
+    vec3 cross(vec3 const & a, vec3 const & b)
+    {
+        return {a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2], a[0] * b[1] - a[1] * b[0]};
+    }
+
+    float dot(vec3 const & a, vec3 const & b)
+    {
+        return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+    }
+
+}
+
+vertex_cache_stats analyze_vertex_cache(std::vector<std::uint32_t> const & indices, std::size_t vertex_count, std::size_t cache_size)
+{
+    vertex_cache_stats result;
+
+    if (indices.empty() || vertex_count == 0)
+        return result;
+
+    // A vertex is in the FIFO cache if fewer than cache_size misses happened since it was loaded
+    std::vector<std::size_t> load_time(vertex_count, 0);
+    std::size_t time = cache_size;
+
+    for (auto v : indices)
+    {
+        if (time - load_time[v] >= cache_size)
+            load_time[v] = time++;
+    }
+
+    std::size_t const transformed = time - cache_size;
+
+    result.acmr = static_cast<float>(transformed) / (indices.size() / 3);
+    result.atvr = static_cast<float>(transformed) / vertex_count;
+    return result;
+}
+
+void optimize_vertex_cache(std::vector<std::uint32_t> & indices, std::size_t vertex_count, std::size_t cache_size,
+    std::vector<std::size_t> * clusters)
+{
+    if (clusters)
+        clusters->assign(1, 0);
+
+    std::size_t const triangle_count = indices.size() / 3;
+    if (triangle_count == 0)
+        return;
+
+    // Triangles adjacent to each vertex
+    std::vector<std::uint32_t> offsets(vertex_count + 1, 0);
+    for (auto v : indices)
+        ++offsets[v + 1];
+    std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+
+    std::vector<std::uint32_t> adjacency(triangle_count * 3);
+    {
+        std::vector<std::uint32_t> fill(offsets.begin(), offsets.end() - 1);
+        for (std::size_t t = 0; t < triangle_count; ++t)
+            for (std::size_t k = 0; k < 3; ++k)
+                adjacency[fill[indices[3 * t + k]]++] = t;
+    }
+
+    // Number of not yet emitted triangles using each vertex
+    std::vector<std::uint32_t> live(vertex_count);
+    for (std::size_t v = 0; v < vertex_count; ++v)
+        live[v] = offsets[v + 1] - offsets[v];
+
+    std::vector<std::size_t> cache_time(vertex_count, 0);
+    std::vector<bool> emitted(triangle_count, false);
+
+    std::vector<std::uint32_t> dead_end;
+    dead_end.reserve(triangle_count * 3);
+
+    std::vector<std::uint32_t> candidates;
+
+    std::vector<std::uint32_t> result;
+    result.reserve(triangle_count * 3);
+
+    std::size_t time = cache_size + 1;
+    std::size_t cursor = 0;
+    std::int64_t fanning = 0;
+
+    while (fanning >= 0)
+    {
+        candidates.clear();
+
+        // Emit all remaining triangles around the fanning vertex
+        for (std::uint32_t a = offsets[fanning]; a < offsets[fanning + 1]; ++a)
+        {
+            std::uint32_t const t = adjacency[a];
+            if (emitted[t]) continue;
+
+            for (std::size_t k = 0; k < 3; ++k)
+            {
+                std::uint32_t const v = indices[3 * t + k];
+                result.push_back(v);
+                dead_end.push_back(v);
+                candidates.push_back(v);
+                --live[v];
+
+                if (time - cache_time[v] > cache_size)
+                    cache_time[v] = time++;
+            }
+
+            emitted[t] = true;
+        }
+
+        // Prefer the candidate that will still be in the cache after fanning around it,
+        // and the one loaded earliest among those
+        std::int64_t next = -1;
+        std::int64_t best_priority = -1;
+        for (auto v : candidates)
+        {
+            if (live[v] == 0) continue;
+
+            std::int64_t priority = 0;
+            if (time - cache_time[v] + 2 * live[v] <= cache_size)
+                priority = time - cache_time[v];
+
+            if (priority > best_priority)
+            {
+                best_priority = priority;
+                next = v;
+            }
+        }
+
+        if (next == -1)
+        {
+            // Dead end: backtrack to a recently used vertex, then fall back to input order
+            while (!dead_end.empty())
+            {
+                std::uint32_t const v = dead_end.back();
+                dead_end.pop_back();
+                if (live[v] > 0)
+                {
+                    next = v;
+                    break;
+                }
+            }
+
+            if (next == -1)
+            {
+                while (cursor < vertex_count && live[cursor] == 0)
+                    ++cursor;
+                if (cursor < vertex_count)
+                    next = cursor;
+            }
+
+            if (next != -1 && clusters && clusters->back() != result.size() / 3)
+                clusters->push_back(result.size() / 3);
+        }
+
+        fanning = next;
+    }
+
+    indices = std::move(result);
+}
+
+void optimize_overdraw(obj_data & mesh, std::vector<std::size_t> const & clusters)
+{
+    std::size_t const triangle_count = mesh.indices.size() / 3;
+    if (clusters.size() < 2 || triangle_count == 0)
+        return;
+
+    auto position = [&](std::size_t t, std::size_t k) -> vec3 const &
+    {
+        return mesh.vertices[mesh.indices[3 * t + k]].position;
+    };
+
+    struct cluster_info
+    {
+        std::size_t begin;
+        std::size_t end;
+        // Area-weighted sums of triangle centroids and normals
+        vec3 center{0.f, 0.f, 0.f};
+        vec3 normal{0.f, 0.f, 0.f};
+        float area = 0.f;
+        float sort_key = 0.f;
+    };
+
+    std::vector<cluster_info> infos(clusters.size());
+
+    vec3 mesh_center{0.f, 0.f, 0.f};
+    float mesh_area = 0.f;
+
+    for (std::size_t c = 0; c < clusters.size(); ++c)
+    {
+        auto & info = infos[c];
+        info.begin = clusters[c];
+        info.end = (c + 1 < clusters.size()) ? clusters[c + 1] : triangle_count;
+
+        for (std::size_t t = info.begin; t < info.end; ++t)
+        {
+            auto const & p0 = position(t, 0);
+            auto const & p1 = position(t, 1);
+            auto const & p2 = position(t, 2);
+
+            vec3 const n = cross(p1 - p0, p2 - p0);
+            float const area = std::sqrt(dot(n, n));
+
+            vec3 centroid = p0;
+            centroid += p1;
+            centroid += p2;
+
+            info.center += centroid * (area / 3.f);
+            info.normal += n;
+            info.area += area;
+        }
+
+        mesh_center += info.center;
+        mesh_area += info.area;
+    }
+
+    if (mesh_area > 0.f)
+        mesh_center = mesh_center * (1.f / mesh_area);
+
+    for (auto & info : infos)
+    {
+        if (info.area == 0.f) continue;
+
+        vec3 const center = info.center * (1.f / info.area);
+        float const length = std::sqrt(dot(info.normal, info.normal));
+        if (length > 0.f)
+            info.sort_key = dot(center - mesh_center, info.normal) / length;
+    }
+
+    std::stable_sort(infos.begin(), infos.end(), [](cluster_info const & a, cluster_info const & b){
+        return a.sort_key > b.sort_key;
+    });
+
+    std::vector<std::uint32_t> result;
+    result.reserve(mesh.indices.size());
+    for (auto const & info : infos)
+        result.insert(result.end(), mesh.indices.begin() + 3 * info.begin, mesh.indices.begin() + 3 * info.end);
+
+    mesh.indices = std::move(result);
+}
+
+void optimize_vertex_fetch(obj_data & mesh)
+{
+    constexpr std::uint32_t unused = -1;
+
+    std::vector<std::uint32_t> remap(mesh.vertices.size(), unused);
+    std::vector<obj_data::vertex> vertices;
+    vertices.reserve(mesh.vertices.size());
+
+    for (auto & index : mesh.indices)
+    {
+        if (remap[index] == unused)
+        {
+            remap[index] = vertices.size();
+            vertices.push_back(mesh.vertices[index]);
+        }
+        index = remap[index];
+    }
+
+    mesh.vertices = std::move(vertices);
+}
+
+void optimize_mesh(obj_data & mesh, std::size_t cache_size)
+{
+    std::vector<std::size_t> clusters;
+    optimize_vertex_cache(mesh.indices, mesh.vertices.size(), cache_size, &clusters);
+    optimize_overdraw(mesh, clusters);
+    optimize_vertex_fetch(mesh);
+}
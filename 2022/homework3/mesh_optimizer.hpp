@@ -0,0 +1,38 @@
+#pragma once
+
+#include "obj_parser.hpp"
+
+#include <vector>
+#include <cstdint>
+
+// Reordering of indexed triangle meshes for the post-transform vertex cache,
+// overdraw and vertex fetch locality. None of these change the rendered image
+// apart from the order of overlapping triangles within a mesh.
+
+struct vertex_cache_stats
+{
+    // Average number of vertex shader invocations per triangle (0.5 is ideal, 3 is worst)
+    float acmr = 0.f;
+    // Average number of vertex shader invocations per vertex (1 is ideal)
+    float atvr = 0.f;
+};
+
+// Simulates a FIFO post-transform cache of the given size
+vertex_cache_stats analyze_vertex_cache(std::vector<std::uint32_t> const & indices, std::size_t vertex_count, std::size_t cache_size = 16);
+
+// Reorders triangles with the Tipsify algorithm (Sander, Nehab and Barczak 2007).
+// If `clusters` is given, it receives the index of the first triangle of every
+// cluster, i.e. of every place where the order starts anew, for optimize_overdraw.
+void optimize_vertex_cache(std::vector<std::uint32_t> & indices, std::size_t vertex_count, std::size_t cache_size = 16,
+    std::vector<std::size_t> * clusters = nullptr);
+
+// Sorts clusters of triangles so that the ones facing away from the mesh center
+// come first, which makes them likely to occlude the rest from any direction
+void optimize_overdraw(obj_data & mesh, std::vector<std::size_t> const & clusters);
+
+// Renumbers the vertices in order of first use, so that vertex fetch walks memory
+// linearly; vertices not referenced by any triangle are removed
+void optimize_vertex_fetch(obj_data & mesh);
+
+// All of the above in order
+void optimize_mesh(obj_data & mesh, std::size_t cache_size = 16);
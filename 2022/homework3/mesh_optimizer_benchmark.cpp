@@ -0,0 +1,129 @@
+#include "mesh_optimizer.hpp"
+#include "gltf_loader.hpp"
+
+#include <iostream>
+#include <chrono>
+#include <string>
+#include <cstdlib>
+
+// Usage: mesh_optimizer_benchmark [--cache-size N] file.obj|file.gltf|file.glb...
+// Reports post-transform cache efficiency of every mesh before and after optimization
+
+namespace
+{
+
+    // Only positions and indices matter for the optimizer
+    obj_data gltf_mesh_to_obj(gltf_model const & model, gltf_model::mesh const & mesh)
+    {
+        obj_data result;
+
+        auto const & position = mesh.position;
+        assert(position.type == 0x1406 && position.size == 3); // GL_FLOAT
+
+        auto const positions = model.attribute_data<std::array<float, 3>>(position);
+
+        result.vertices.resize(position.count);
+        for (std::size_t i = 0; i < position.count; ++i)
+        {
+            auto & v = result.vertices[i];
+            v.position = positions[i];
+            v.normal = {0.f, 0.f, 0.f};
+            v.texcoord = {0.f, 0.f};
+        }
+
+        auto const & indices = mesh.indices;
+        auto copy_indices = [&](auto index_type)
+        {
+            auto const source = model.accessor_data<decltype(index_type)>(indices);
+            result.indices.assign(source.begin(), source.end());
+        };
+
+        switch (indices.type)
+        {
+        case 0x1401: // GL_UNSIGNED_BYTE
+            copy_indices(std::uint8_t{});
+            break;
+        case 0x1403: // GL_UNSIGNED_SHORT
+            copy_indices(std::uint16_t{});
+            break;
+        case 0x1405: // GL_UNSIGNED_INT
+            copy_indices(std::uint32_t{});
+            break;
+        default:
+            throw std::runtime_error("Unsupported index type: " + std::to_string(indices.type));
+        }
+
+        return result;
+    }
+
+    void report(std::string const & name, obj_data mesh, std::size_t cache_size)
+    {
+        auto const before = analyze_vertex_cache(mesh.indices, mesh.vertices.size(), cache_size);
+
+        auto start = std::chrono::high_resolution_clock::now();
+
+        std::vector<std::size_t> clusters;
+        optimize_vertex_cache(mesh.indices, mesh.vertices.size(), cache_size, &clusters);
+        auto const after_cache = analyze_vertex_cache(mesh.indices, mesh.vertices.size(), cache_size);
+
+        optimize_overdraw(mesh, clusters);
+        optimize_vertex_fetch(mesh);
+
+        auto end = std::chrono::high_resolution_clock::now();
+
+        auto const after = analyze_vertex_cache(mesh.indices, mesh.vertices.size(), cache_size);
+
+        double time = std::chrono::duration_cast<std::chrono::duration<double>>(end - start).count();
+
+        std::cout << name << '\n';
+        std::cout << "    triangles:        " << mesh.indices.size() / 3 << '\n';
+        std::cout << "    vertices:         " << mesh.vertices.size() << '\n';
+        std::cout << "    clusters:         " << clusters.size() << '\n';
+        std::cout << "    ACMR / ATVR:      " << before.acmr << " / " << before.atvr << " (input)\n";
+        std::cout << "                      " << after_cache.acmr << " / " << after_cache.atvr << " (vertex cache)\n";
+        std::cout << "                      " << after.acmr << " / " << after.atvr << " (vertex cache + overdraw)\n";
+        std::cout << "    time:             " << time * 1000.0 << " ms\n";
+    }
+
+}
+
+int main(int argc, char ** argv) try
+{
+    std::size_t cache_size = 16;
+
+    std::vector<std::filesystem::path> paths;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (argv[i] == std::string("--cache-size") && i + 1 < argc)
+            cache_size = std::max(1, std::atoi(argv[++i]));
+        else
+            paths.emplace_back(argv[i]);
+    }
+
+    if (paths.empty())
+    {
+        std::cerr << "Usage: " << argv[0] << " [--cache-size N] file.obj|file.gltf|file.glb..." << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    for (auto const & path : paths)
+    {
+        if (path.extension() == ".gltf" || path.extension() == ".glb")
+        {
+            auto const model = load_gltf(path);
+            for (auto const & mesh : model.meshes)
+                report(path.string() + " : " + mesh.name, gltf_mesh_to_obj(model, mesh), cache_size);
+        }
+        else
+        {
+            obj_parse_options options;
+            options.use_cache = false;
+            report(path.string(), parse_obj(path, nullptr, options), cache_size);
+        }
+    }
+}
+catch (std::exception const & e)
+{
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,128 @@
+#include "obj_parser.hpp"
+#include "vertex_quantization.hpp"
+
+#include <iostream>
+#include <chrono>
+#include <string>
+#include <cstdlib>
+#include <algorithm>
+
+// Usage: obj_parser_benchmark [--iterations N] [--threads N] [--cache] [--batch N] [--quantize] file.obj...
+// With --cache, the first iteration writes the binary cache and the rest load from it
+// With --batch, the file is also read with stream_obj in batches of N triangles
+// With --quantize, the mesh is also converted to packed_vertex and the error bounds are printed
+
+int main(int argc, char ** argv) try
+{
+    int iterations = 10;
+    std::size_t batch_triangles = 0;
+    bool quantize = false;
+
+    obj_parse_options options;
+    options.use_cache = false;
+
+    std::vector<std::filesystem::path> paths;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (argv[i] == std::string("--iterations") && i + 1 < argc)
+            iterations = std::max(1, std::atoi(argv[++i]));
+        else if (argv[i] == std::string("--threads") && i + 1 < argc)
+            options.thread_count = std::max(0, std::atoi(argv[++i]));
+        else if (argv[i] == std::string("--cache"))
+            options.use_cache = true;
+        else if (argv[i] == std::string("--batch") && i + 1 < argc)
+            batch_triangles = std::max(0, std::atoi(argv[++i]));
+        else if (argv[i] == std::string("--quantize"))
+            quantize = true;
+        else
+            paths.emplace_back(argv[i]);
+    }
+
+    if (paths.empty())
+    {
+        std::cerr << "Usage: " << argv[0] << " [--iterations N] [--threads N] [--cache] [--batch N] [--quantize] file.obj..." << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    for (auto const & path : paths)
+    {
+        double const file_size = std::filesystem::file_size(path);
+
+        obj_parse_stats stats;
+        obj_data data;
+
+        double best_time = 1e30;
+        double total_time = 0.0;
+
+        for (int i = 0; i < iterations; ++i)
+        {
+            auto start = std::chrono::high_resolution_clock::now();
+            data = parse_obj(path, &stats, options);
+            auto end = std::chrono::high_resolution_clock::now();
+
+            double time = std::chrono::duration_cast<std::chrono::duration<double>>(end - start).count();
+            best_time = std::min(best_time, time);
+            total_time += time;
+        }
+
+        double const hit_rate = stats.face_corners == 0 ? 0.0 :
+            1.0 - static_cast<double>(stats.unique_vertices) / stats.face_corners;
+
+        std::cout << path.string() << '\n';
+        std::cout << "    source:      " << (stats.cached ? "cache" : "text") << '\n';
+        std::cout << "    size:        " << file_size / (1 << 20) << " MB\n";
+        std::cout << "    vertices:    " << data.vertices.size() << '\n';
+        std::cout << "    triangles:   " << data.indices.size() / 3 << '\n';
+        std::cout << "    corners:     " << stats.face_corners << '\n';
+        std::cout << "    dedup hits:  " << hit_rate * 100.0 << "%\n";
+        std::cout << "    best time:   " << best_time * 1000.0 << " ms\n";
+        std::cout << "    mean time:   " << total_time / iterations * 1000.0 << " ms\n";
+        std::cout << "    throughput:  " << file_size / best_time / (1 << 20) << " MB/s\n";
+
+        if (batch_triangles > 0)
+        {
+            std::size_t batch_count = 0;
+            std::size_t max_batch_vertices = 0;
+
+            auto start = std::chrono::high_resolution_clock::now();
+            stream_obj(path, batch_triangles, [&](obj_data const & batch){
+                ++batch_count;
+                max_batch_vertices = std::max(max_batch_vertices, batch.vertices.size());
+            });
+            auto end = std::chrono::high_resolution_clock::now();
+
+            double time = std::chrono::duration_cast<std::chrono::duration<double>>(end - start).count();
+
+            std::cout << "    stream batches:       " << batch_count << '\n';
+            std::cout << "    stream max vertices:  " << max_batch_vertices << '\n';
+            std::cout << "    stream time:          " << time * 1000.0 << " ms\n";
+        }
+
+        if (quantize)
+        {
+            quantization_error error;
+
+            auto start = std::chrono::high_resolution_clock::now();
+            auto packed = pack_obj(data, &error);
+            auto end = std::chrono::high_resolution_clock::now();
+
+            double time = std::chrono::duration_cast<std::chrono::duration<double>>(end - start).count();
+
+            float extent = 0.f;
+            for (auto s : packed.position_scale)
+                extent = std::max(extent, s);
+
+            std::cout << "    packed vertex data:   " << packed.vertices.size() * sizeof(packed_vertex) / double(1 << 20) << " MB"
+                << " (was " << data.vertices.size() * sizeof(obj_data::vertex) / double(1 << 20) << " MB)\n";
+            std::cout << "    position error:       " << error.position << " (" << (extent > 0.f ? error.position / extent : 0.f) * 100.f << "% of extent)\n";
+            std::cout << "    normal error:         " << error.normal * 180.f / 3.14159265f << " degrees\n";
+            std::cout << "    texcoord error:       " << error.texcoord << '\n';
+            std::cout << "    pack time:            " << time * 1000.0 << " ms\n";
+        }
+    }
+}
+catch (std::exception const & e)
+{
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+}
@@ -3,12 +3,25 @@ const char shadow_vertex_shader_source[] =
 
 uniform mat4 shadow_projection;
 
-uniform mat4x3 bones[64];
+uniform samplerBuffer bones;
+uniform int bone_count;
 uniform bool use_bones;
 
 layout (location = 0) in vec3 in_position;
 layout (location = 3) in ivec4 in_joints;
 layout (location = 4) in vec4 in_weights;
+layout (location = 5) in vec3 in_instance_offset;
+
+// The bone matrices of all instances, bone_count per instance, each stored
+// as the twelve floats of a mat4x3 in three RGBA texels
+mat4x3 bone_matrix(int bone)
+{
+    int texel = 3 * (gl_InstanceID * bone_count + bone);
+    vec4 a = texelFetch(bones, texel);
+    vec4 b = texelFetch(bones, texel + 1);
+    vec4 c = texelFetch(bones, texel + 2);
+    return mat4x3(a.xyz, vec3(a.w, b.xy), vec3(b.zw, c.x), c.yzw);
+}
 
 void main()
 {
@@ -17,8 +30,9 @@ void main()
                          0, 0, 1,
                          0, 0, 0);
     if (use_bones) {
-        average = bones[in_joints[0]] * in_weights[0] + bones[in_joints[1]] * in_weights[1] + bones[in_joints[2]] * in_weights[2] + bones[in_joints[3]] * in_weights[3];
+        average = bone_matrix(in_joints[0]) * in_weights[0] + bone_matrix(in_joints[1]) * in_weights[1] + bone_matrix(in_joints[2]) * in_weights[2] + bone_matrix(in_joints[3]) * in_weights[3];
         average /= 2.5;
+        average[3] += in_instance_offset;
     }
 
     gl_Position = shadow_projection * mat4(average) * vec4(in_position, 1.0);
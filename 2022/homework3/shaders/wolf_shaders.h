@@ -6,19 +6,32 @@ uniform mat4 view;
 uniform mat4 projection;
 uniform bool use_bones;
 
-uniform mat4x3 bones[64];
+uniform samplerBuffer bones;
+uniform int bone_count;
 
 layout (location = 0) in vec3 in_position;
 layout (location = 1) in vec3 in_normal;
 layout (location = 2) in vec2 in_texcoord;
 layout (location = 3) in ivec4 in_joints;
 layout (location = 4) in vec4 in_weights;
+layout (location = 5) in vec3 in_instance_offset;
 
 out vec3 position;
 out vec3 normal;
 out vec2 texcoord;
 out vec4 weights;
 
+// The bone matrices of all instances, bone_count per instance, each stored
+// as the twelve floats of a mat4x3 in three RGBA texels
+mat4x3 bone_matrix(int bone)
+{
+    int texel = 3 * (gl_InstanceID * bone_count + bone);
+    vec4 a = texelFetch(bones, texel);
+    vec4 b = texelFetch(bones, texel + 1);
+    vec4 c = texelFetch(bones, texel + 2);
+    return mat4x3(a.xyz, vec3(a.w, b.xy), vec3(b.zw, c.x), c.yzw);
+}
+
 void main()
 {
     mat4x3 average = mat4x3(1, 0, 0,
@@ -26,8 +39,9 @@ void main()
                          0, 0, 1,
                          0, 0, 0);
     if (use_bones) {
-        average = bones[in_joints[0]] * in_weights[0] + bones[in_joints[1]] * in_weights[1] + bones[in_joints[2]] * in_weights[2] + bones[in_joints[3]] * in_weights[3];
+        average = bone_matrix(in_joints[0]) * in_weights[0] + bone_matrix(in_joints[1]) * in_weights[1] + bone_matrix(in_joints[2]) * in_weights[2] + bone_matrix(in_joints[3]) * in_weights[3];
         average /= 2.5;
+        average[3] += in_instance_offset;
     }
 
     position = vec3(mat4(average) * model * vec4(in_position, 1.0));
@@ -0,0 +1,140 @@
+#include "gltf_loader.hpp"
+#include "gltf_skinning.hpp"
+#include "baked_animation.hpp"
+#include "skeleton_evaluator.hpp"
+
+#include <iostream>
+#include <chrono>
+#include <string>
+#include <cstdlib>
+#include <algorithm>
+
+// Usage: skinning_benchmark [--iterations N] [--threads N] [file.gltf]
+// Skins every mesh of the model on the CPU at a series of poses of its first
+// animation: with the glm reference that mirrors the vertex shaders, with the
+// SSE kernel on one thread, and with it on a worker pool. Prints the cost per
+// vertex and the largest difference from the reference, which is what a
+// GPU-less check of the shader path compares against.
+
+namespace
+{
+
+    constexpr int pose_count = 16;
+
+    template <typename Pass>
+    double measure(int iterations, Pass && pass)
+    {
+        double best_time = 1e30;
+        for (int i = 0; i < iterations; ++i)
+        {
+            auto start = std::chrono::high_resolution_clock::now();
+            pass();
+            auto end = std::chrono::high_resolution_clock::now();
+
+            best_time = std::min(best_time, std::chrono::duration_cast<std::chrono::duration<double>>(end - start).count());
+        }
+        return best_time;
+    }
+
+    float difference(skinned_vertices const & a, skinned_vertices const & b)
+    {
+        float result = 0.f;
+        for (std::size_t v = 0; v < a.positions.size(); ++v)
+        {
+            result = std::max(result, glm::length(a.positions[v] - b.positions[v]));
+            result = std::max(result, glm::length(a.normals[v] - b.normals[v]));
+        }
+        return result;
+    }
+
+}
+
+int main(int argc, char ** argv) try
+{
+    int iterations = 10;
+    std::size_t threads = 0;
+    std::filesystem::path path = PROJECT_ROOT "/Macarena/Macarena.gltf";
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (argv[i] == std::string("--iterations") && i + 1 < argc)
+            iterations = std::max(1, std::atoi(argv[++i]));
+        else if (argv[i] == std::string("--threads") && i + 1 < argc)
+            threads = std::max(1, std::atoi(argv[++i]));
+        else
+            path = argv[i];
+    }
+
+    auto const model = load_gltf(path);
+    if (model.animations.empty())
+        throw std::runtime_error("No animations in " + path.string());
+
+    std::vector<skinning_mesh> meshes;
+    std::size_t vertex_count = 0;
+    for (auto const & mesh : model.meshes)
+    {
+        meshes.push_back(make_skinning_mesh(model, mesh));
+        vertex_count += meshes.back().size();
+    }
+
+    auto const animation = bake_animation(model.animations.begin()->second);
+    skeleton_evaluator evaluator(model.bones, model.skins[drawn_skin(model)]);
+    skeleton_pose pose;
+
+    std::vector<std::vector<glm::mat4x3>> palettes(pose_count, std::vector<glm::mat4x3>(evaluator.size()));
+    for (int i = 0; i < pose_count; ++i)
+    {
+        animation.sample(animation.duration * i / pose_count, pose);
+        evaluator.evaluate(pose, palettes[i]);
+    }
+
+    worker_pool single_thread(1);
+    worker_pool pool(threads);
+
+    std::vector<skinned_vertices> reference(meshes.size()), result(meshes.size());
+
+    auto skin_all = [&](auto && skin){
+        return measure(iterations, [&]{
+            for (auto const & palette : palettes)
+                for (std::size_t m = 0; m < meshes.size(); ++m)
+                    skin(meshes[m], palette, m);
+        });
+    };
+
+    double const reference_time = skin_all([&](auto const & mesh, auto const & palette, std::size_t m){
+        skin_mesh_reference(mesh, palette, reference[m]);
+    });
+    double const single_time = skin_all([&](auto const & mesh, auto const & palette, std::size_t m){
+        skin_mesh(mesh, palette, result[m], single_thread);
+    });
+    double const pool_time = skin_all([&](auto const & mesh, auto const & palette, std::size_t m){
+        skin_mesh(mesh, palette, result[m], pool);
+    });
+
+    float error = 0.f;
+    for (auto const & palette : palettes)
+    {
+        for (std::size_t m = 0; m < meshes.size(); ++m)
+        {
+            skin_mesh_reference(meshes[m], palette, reference[m]);
+            skin_mesh(meshes[m], palette, result[m], pool);
+            error = std::max(error, difference(reference[m], result[m]));
+        }
+    }
+
+    double const per_vertex = 1e9 / (double(vertex_count) * pose_count);
+
+    std::cout << path.string() << '\n';
+    std::cout << "    meshes:               " << meshes.size() << '\n';
+    std::cout << "    vertices:             " << vertex_count << '\n';
+    std::cout << "    bones:                " << model.bones.size() << '\n';
+    std::cout << "    reference:            " << reference_time * per_vertex << " ns/vertex\n";
+    std::cout << "    sse, 1 thread:        " << single_time * per_vertex << " ns/vertex\n";
+    std::cout << "    sse, " << pool.size() << " threads:       " << pool_time * per_vertex << " ns/vertex\n";
+    std::cout << "    max difference:       " << error << '\n';
+}
+catch (std::exception const & e)
+{
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+}
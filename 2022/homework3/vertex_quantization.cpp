@@ -0,0 +1,234 @@
+#include "vertex_quantization.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <cmath>
+
+namespace
+{
+
+    using vec3 = std::array<float, 3>;
+
+    constexpr float unorm16_max = 65535.f;
+    constexpr float snorm16_max = 32767.f;
+
+    std::int16_t to_snorm16(float value)
+    {
+        return static_cast<std::int16_t>(std::lround(std::clamp(value, -1.f, 1.f) * snorm16_max));
+    }
+
+    float from_snorm16(std::int16_t value)
+    {
+        return std::max(value / snorm16_max, -1.f);
+    }
+
+    float dot(vec3 const & a, vec3 const & b)
+    {
+        return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+    }
+
+}
+
+std::uint16_t float_to_half(float value)
+{
+    std::uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+
+    std::uint16_t const sign = (bits >> 16) & 0x8000u;
+    std::uint32_t const magnitude = bits & 0x7FFFFFFFu;
+
+    // Infinity and NaN
+    if (magnitude >= 0x7F800000u)
+        return sign | (magnitude > 0x7F800000u ? 0x7E00u : 0x7C00u);
+
+    // Rounds to infinity (65520 and above)
+    if (magnitude >= 0x477FF000u)
+        return sign | 0x7C00u;
+
+    // Below the smallest normal half (2^-14): the result is a multiple of 2^-24
+    if (magnitude < 0x38800000u)
+    {
+        float absolute;
+        std::memcpy(&absolute, &magnitude, sizeof(absolute));
+        return sign | static_cast<std::uint16_t>(std::nearbyint(absolute * 16777216.f));
+    }
+
+    // Rebias the exponent from 127 to 15 and round the mantissa to nearest even
+    std::uint32_t result = (magnitude - 0x38000000u) >> 13;
+    std::uint32_t const remainder = magnitude & 0x1FFFu;
+    if (remainder > 0x1000u || (remainder == 0x1000u && (result & 1u)))
+        ++result;
+
+    return sign | static_cast<std::uint16_t>(result);
+}
+
+float half_to_float(std::uint16_t value)
+{
+    std::uint32_t const sign = static_cast<std::uint32_t>(value & 0x8000u) << 16;
+    std::uint32_t const exponent = (value >> 10) & 0x1Fu;
+    std::uint32_t const mantissa = value & 0x3FFu;
+
+    if (exponent == 0)
+    {
+        float const result = std::ldexp(static_cast<float>(mantissa), -24);
+        return sign ? -result : result;
+    }
+
+    std::uint32_t bits;
+    if (exponent == 0x1Fu)
+        bits = sign | 0x7F800000u | (mantissa << 13);
+    else
+        bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+
+    float result;
+    std::memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+
+std::array<std::int16_t, 2> octahedral_encode(std::array<float, 3> const & normal)
+{
+    float const length = std::abs(normal[0]) + std::abs(normal[1]) + std::abs(normal[2]);
+    if (length == 0.f)
+        return {0, 0};
+
+    // Project onto the octahedron |x| + |y| + |z| = 1, then fold the lower half over the upper one
+    float x = normal[0] / length;
+    float y = normal[1] / length;
+
+    if (normal[2] < 0.f)
+    {
+        float const folded_x = (1.f - std::abs(y)) * (x >= 0.f ? 1.f : -1.f);
+        float const folded_y = (1.f - std::abs(x)) * (y >= 0.f ? 1.f : -1.f);
+        x = folded_x;
+        y = folded_y;
+    }
+
+    return {to_snorm16(x), to_snorm16(y)};
+}
+
+std::array<float, 3> octahedral_decode(std::array<std::int16_t, 2> const & normal)
+{
+    vec3 result{from_snorm16(normal[0]), from_snorm16(normal[1]), 0.f};
+    result[2] = 1.f - std::abs(result[0]) - std::abs(result[1]);
+
+    float const t = std::max(-result[2], 0.f);
+    result[0] += (result[0] >= 0.f) ? -t : t;
+    result[1] += (result[1] >= 0.f) ? -t : t;
+
+    float const length = std::sqrt(dot(result, result));
+    for (auto & c : result)
+        c /= length;
+
+    return result;
+}
+
+packed_obj_data pack_obj(obj_data const & data, quantization_error * error)
+{
+    packed_obj_data result;
+    result.indices = data.indices;
+
+    vec3 min, max;
+    min.fill(std::numeric_limits<float>::infinity());
+    max.fill(-std::numeric_limits<float>::infinity());
+
+    for (auto const & vertex : data.vertices)
+    {
+        for (int i = 0; i < 3; ++i)
+        {
+            min[i] = std::min(min[i], vertex.position[i]);
+            max[i] = std::max(max[i], vertex.position[i]);
+        }
+    }
+
+    if (data.vertices.empty())
+    {
+        min.fill(0.f);
+        max.fill(0.f);
+    }
+
+    vec3 inverse_scale;
+    for (int i = 0; i < 3; ++i)
+    {
+        result.position_offset[i] = min[i];
+        result.position_scale[i] = max[i] - min[i];
+        inverse_scale[i] = (result.position_scale[i] > 0.f) ? unorm16_max / result.position_scale[i] : 0.f;
+    }
+
+    result.vertices.resize(data.vertices.size());
+    for (std::size_t v = 0; v < data.vertices.size(); ++v)
+    {
+        auto const & source = data.vertices[v];
+        auto & target = result.vertices[v];
+
+        for (int i = 0; i < 3; ++i)
+        {
+            float const q = (source.position[i] - min[i]) * inverse_scale[i];
+            target.position[i] = static_cast<std::uint16_t>(std::lround(std::clamp(q, 0.f, unorm16_max)));
+        }
+        target.padding = 0;
+        target.normal = octahedral_encode(source.normal);
+        for (int i = 0; i < 2; ++i)
+            target.texcoord[i] = float_to_half(source.texcoord[i]);
+    }
+
+    if (error)
+    {
+        *error = quantization_error{};
+
+        obj_data const decoded = unpack_obj(result);
+        for (std::size_t v = 0; v < data.vertices.size(); ++v)
+        {
+            auto const & original = data.vertices[v];
+            auto const & restored = decoded.vertices[v];
+
+            vec3 delta;
+            for (int i = 0; i < 3; ++i)
+                delta[i] = original.position[i] - restored.position[i];
+            error->position = std::max(error->position, std::sqrt(dot(delta, delta)));
+
+            float const length = std::sqrt(dot(original.normal, original.normal));
+            if (length > 0.f)
+            {
+                float const cosine = std::clamp(dot(original.normal, restored.normal) / length, -1.f, 1.f);
+                error->normal = std::max(error->normal, std::acos(cosine));
+            }
+
+            for (int i = 0; i < 2; ++i)
+                error->texcoord = std::max(error->texcoord, std::abs(original.texcoord[i] - restored.texcoord[i]));
+        }
+    }
+
+    return result;
+}
+
+obj_data unpack_obj(packed_obj_data const & data)
+{
+    obj_data result;
+    result.indices = data.indices;
+
+    result.vertices.resize(data.vertices.size());
+    for (std::size_t v = 0; v < data.vertices.size(); ++v)
+    {
+        auto const & source = data.vertices[v];
+        auto & target = result.vertices[v];
+
+        for (int i = 0; i < 3; ++i)
+            target.position[i] = data.position_offset[i] + data.position_scale[i] * (source.position[i] / unorm16_max);
+        target.normal = octahedral_decode(source.normal);
+        for (int i = 0; i < 2; ++i)
+            target.texcoord[i] = half_to_float(source.texcoord[i]);
+    }
+
+    return result;
+}
+
+const char octahedral_decode_glsl[] =
+R"(vec3 octahedral_decode(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.xy += mix(vec2(t), vec2(-t), greaterThanEqual(n.xy, vec2(0.0)));
+    return normalize(n);
+}
+)";
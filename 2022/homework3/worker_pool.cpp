@@ -0,0 +1,93 @@
+#include "worker_pool.hpp"
+
+#include <algorithm>
+
+// Each worker gets about this many chunks of a loop, to even out uneven chunks
+static constexpr std::size_t chunks_per_worker = 4;
+
+worker_pool::worker_pool(std::size_t size)
+{
+    if (size == 0)
+        size = std::max(1u, std::thread::hardware_concurrency());
+
+    threads_.reserve(size - 1);
+    for (std::size_t worker = 1; worker < size; ++worker)
+        threads_.emplace_back([this, worker]{ thread_main(worker); });
+}
+
+worker_pool::~worker_pool()
+{
+    {
+        std::lock_guard lock(mutex_);
+        stop_ = true;
+    }
+    start_.notify_all();
+
+    for (auto & thread : threads_)
+        thread.join();
+}
+
+void worker_pool::run(std::size_t count, task task, void * body)
+{
+    if (count == 0)
+        return;
+
+    chunk_size_ = std::max<std::size_t>(1, count / (size() * chunks_per_worker));
+
+    if (threads_.empty() || count <= chunk_size_)
+    {
+        task(body, 0, count, 0);
+        return;
+    }
+
+    {
+        std::lock_guard lock(mutex_);
+        task_ = task;
+        body_ = body;
+        count_ = count;
+        next_.store(0, std::memory_order_relaxed);
+        busy_ = threads_.size();
+        ++generation_;
+    }
+    start_.notify_all();
+
+    work(0);
+
+    std::unique_lock lock(mutex_);
+    done_.wait(lock, [this]{ return busy_ == 0; });
+}
+
+void worker_pool::work(std::size_t worker)
+{
+    while (true)
+    {
+        std::size_t const begin = next_.fetch_add(chunk_size_, std::memory_order_relaxed);
+        if (begin >= count_)
+            break;
+        task_(body_, begin, std::min(begin + chunk_size_, count_), worker);
+    }
+}
+
+void worker_pool::thread_main(std::size_t worker)
+{
+    std::size_t generation = 0;
+
+    while (true)
+    {
+        {
+            std::unique_lock lock(mutex_);
+            start_.wait(lock, [&]{ return stop_ || generation_ != generation; });
+            if (stop_)
+                return;
+            generation = generation_;
+        }
+
+        work(worker);
+
+        {
+            std::lock_guard lock(mutex_);
+            --busy_;
+        }
+        done_.notify_one();
+    }
+}
@@ -0,0 +1,219 @@
+#include "obj_cache.hpp"
+#include "mapped_file.hpp"
+
+#include <fstream>
+#include <cstring>
+#include <cstdint>
+
+namespace
+{
+
+    constexpr char obj_cache_magic[4] = {'O', 'B', 'J', 'C'};
+
+    // Increment when the layout of the cache or of obj_data::vertex changes
+    constexpr std::uint32_t obj_cache_version = 1;
+
+    struct obj_cache_header
+    {
+        char magic[4];
+        std::uint32_t version;
+        std::uint32_t vertex_size;
+        std::uint32_t index_size;
+
+        std::uint64_t source_size;
+        std::int64_t source_time;
+        std::uint64_t source_hash;
+
+        std::uint64_t vertex_count;
+        std::uint64_t index_count;
+        std::uint64_t face_corners;
+    };
+
+    static_assert(sizeof(obj_cache_header) == 64);
+
+    std::uint64_t hash_bytes(std::string_view data)
+    {
+        constexpr std::uint64_t multiplier = 0x9E3779B97F4A7C15ull;
+
+        std::uint64_t h = 0xCBF29CE484222325ull ^ data.size();
+
+        std::size_t i = 0;
+        for (; i + 8 <= data.size(); i += 8)
+        {
+            std::uint64_t word;
+            std::memcpy(&word, data.data() + i, 8);
+            h = (h ^ word) * multiplier;
+            h ^= h >> 32;
+        }
+
+        for (; i < data.size(); ++i)
+            h = (h ^ static_cast<unsigned char>(data[i])) * multiplier;
+
+        return h ^ (h >> 29);
+    }
+
+    std::int64_t file_time(std::filesystem::path const & path, std::error_code & error)
+    {
+        return std::filesystem::last_write_time(path, error).time_since_epoch().count();
+    }
+
+}
+
+std::filesystem::path obj_cache_path(std::filesystem::path const & source_path)
+{
+    return std::filesystem::path(source_path).replace_extension(".objc");
+}
+
+std::optional<obj_data> load_obj_cache(std::filesystem::path const & source_path, obj_parse_stats * stats)
+{
+    auto const cache_path = obj_cache_path(source_path);
+
+    std::error_code error;
+    if (!std::filesystem::exists(cache_path, error))
+        return std::nullopt;
+
+    auto const source_size = std::filesystem::file_size(source_path, error);
+    if (error)
+        return std::nullopt;
+
+    auto const source_time = file_time(source_path, error);
+    if (error)
+        return std::nullopt;
+
+    mapped_file cache;
+    try
+    {
+        cache = mapped_file(cache_path);
+    }
+    catch (std::exception const &)
+    {
+        return std::nullopt;
+    }
+
+    obj_cache_header header;
+    if (cache.size() < sizeof(header))
+        return std::nullopt;
+    std::memcpy(&header, cache.data(), sizeof(header));
+
+    if (std::memcmp(header.magic, obj_cache_magic, sizeof(obj_cache_magic)) != 0
+        || header.version != obj_cache_version
+        || header.vertex_size != sizeof(obj_data::vertex)
+        || header.index_size != sizeof(std::uint32_t))
+        return std::nullopt;
+
+    std::size_t const payload_size = cache.size() - sizeof(header);
+    if (header.vertex_count > payload_size / sizeof(obj_data::vertex)
+        || header.index_count > payload_size / sizeof(std::uint32_t)
+        || header.vertex_count * sizeof(obj_data::vertex) + header.index_count * sizeof(std::uint32_t) != payload_size)
+        return std::nullopt;
+
+    if (header.source_size != source_size)
+        return std::nullopt;
+
+    // A different modification time alone does not invalidate the cache, since
+    // e.g. a fresh checkout touches every file without changing it
+    bool const touched = (header.source_time != source_time);
+    if (touched)
+    {
+        try
+        {
+            if (hash_bytes(mapped_file(source_path).view()) != header.source_hash)
+                return std::nullopt;
+        }
+        catch (std::exception const &)
+        {
+            return std::nullopt;
+        }
+    }
+
+    obj_data result;
+    result.vertices.resize(header.vertex_count);
+    result.indices.resize(header.index_count);
+
+    char const * payload = cache.data() + sizeof(header);
+    std::memcpy(result.vertices.data(), payload, header.vertex_count * sizeof(obj_data::vertex));
+    payload += header.vertex_count * sizeof(obj_data::vertex);
+    std::memcpy(result.indices.data(), payload, header.index_count * sizeof(std::uint32_t));
+
+    cache = mapped_file();
+
+    // Remember the new time so that the next load does not hash the source again
+    if (touched)
+    {
+        header.source_time = source_time;
+        std::fstream output(cache_path, std::ios::in | std::ios::out | std::ios::binary);
+        output.write(reinterpret_cast<char const *>(&header), sizeof(header));
+    }
+
+    if (stats)
+    {
+        stats->face_corners = header.face_corners;
+        stats->unique_vertices = header.vertex_count;
+        stats->cached = true;
+    }
+
+    return result;
+}
+
+bool save_obj_cache(std::filesystem::path const & source_path, obj_data const & data, obj_parse_stats const & stats)
+{
+    obj_cache_header header;
+    std::memcpy(header.magic, obj_cache_magic, sizeof(obj_cache_magic));
+    header.version = obj_cache_version;
+    header.vertex_size = sizeof(obj_data::vertex);
+    header.index_size = sizeof(std::uint32_t);
+    header.vertex_count = data.vertices.size();
+    header.index_count = data.indices.size();
+    header.face_corners = stats.face_corners;
+
+    std::error_code error;
+
+    header.source_size = std::filesystem::file_size(source_path, error);
+    if (error)
+        return false;
+
+    header.source_time = file_time(source_path, error);
+    if (error)
+        return false;
+
+    try
+    {
+        header.source_hash = hash_bytes(mapped_file(source_path).view());
+    }
+    catch (std::exception const &)
+    {
+        return false;
+    }
+
+    auto const cache_path = obj_cache_path(source_path);
+
+    // Write to a temporary file first so that a concurrent reader never sees a partial cache
+    auto temp_path = cache_path;
+    temp_path += ".tmp";
+
+    {
+        std::ofstream output(temp_path, std::ios::binary | std::ios::trunc);
+        if (!output)
+            return false;
+
+        output.write(reinterpret_cast<char const *>(&header), sizeof(header));
+        output.write(reinterpret_cast<char const *>(data.vertices.data()), data.vertices.size() * sizeof(obj_data::vertex));
+        output.write(reinterpret_cast<char const *>(data.indices.data()), data.indices.size() * sizeof(std::uint32_t));
+
+        if (!output)
+        {
+            output.close();
+            std::filesystem::remove(temp_path, error);
+            return false;
+        }
+    }
+
+    std::filesystem::rename(temp_path, cache_path, error);
+    if (error)
+    {
+        std::filesystem::remove(temp_path, error);
+        return false;
+    }
+
+    return true;
+}
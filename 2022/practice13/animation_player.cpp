@@ -0,0 +1,201 @@
+#include "animation_player.hpp"
+
+#include <cmath>
+#include <cassert>
+#include <stdexcept>
+#include <string>
+#include <algorithm>
+
+animation_player::animation_player(std::vector<gltf_model::bone> const & bones, std::size_t max_layers)
+    : bone_count_(bones.size())
+    , layers_(max_layers)
+{
+    rest_pose_.resize(bone_count_);
+    for (std::size_t b = 0; b < bone_count_; ++b)
+    {
+        rest_pose_.translations[b] = bones[b].translation;
+        rest_pose_.rotations[b] = bones[b].rotation;
+        rest_pose_.scales[b] = bones[b].scale;
+    }
+
+    for (auto & layer : layers_)
+    {
+        layer.sampler.reserve(bone_count_);
+        layer.pose.resize(bone_count_);
+    }
+}
+
+void animation_player::play(gltf_model::animation const & animation)
+{
+    cross_fade(animation, 0.f);
+
+    auto & layer = layers_[0];
+    layer.time = 0.f;
+    layer.sampler.reset();
+}
+
+void animation_player::cross_fade(gltf_model::animation const & animation, float duration)
+{
+    auto & target = find_or_add(animation);
+
+    for (std::size_t i = 0; i < layer_count_; ++i)
+    {
+        auto & layer = layers_[i];
+        layer.target_weight = (&layer == &target) ? 1.f : 0.f;
+
+        if (duration > 0.f)
+            layer.fade_speed = std::abs(layer.target_weight - layer.weight) / duration;
+        else
+        {
+            layer.weight = layer.target_weight;
+            layer.fade_speed = 0.f;
+        }
+    }
+
+    // Layers that are silent already have nothing to fade out; update() would never reach them
+    for (std::size_t i = 0; i < layer_count_;)
+    {
+        if (layers_[i].weight == 0.f && layers_[i].target_weight == 0.f)
+            remove(i);
+        else
+            ++i;
+    }
+}
+
+void animation_player::set_weight(gltf_model::animation const & animation, float weight)
+{
+    auto & layer = find_or_add(animation);
+    layer.weight = layer.target_weight = weight;
+    layer.fade_speed = 0.f;
+}
+
+void animation_player::set_speed(gltf_model::animation const & animation, float speed)
+{
+    find_or_add(animation).speed = speed;
+}
+
+void animation_player::update(float dt)
+{
+    for (std::size_t i = 0; i < layer_count_;)
+    {
+        auto & layer = layers_[i];
+
+        float const duration = layer.sampler.animation().max_time;
+        layer.time = (duration > 0.f) ? std::fmod(layer.time + layer.speed * dt, duration) : 0.f;
+        if (layer.time < 0.f)
+            layer.time += duration;
+
+        if (layer.fade_speed > 0.f)
+        {
+            float const step = layer.fade_speed * dt;
+            if (std::abs(layer.target_weight - layer.weight) <= step)
+            {
+                layer.weight = layer.target_weight;
+                layer.fade_speed = 0.f;
+
+                if (layer.weight == 0.f)
+                {
+                    remove(i);
+                    continue;
+                }
+            }
+            else
+                layer.weight += (layer.target_weight > layer.weight) ? step : -step;
+        }
+
+        ++i;
+    }
+}
+
+void animation_player::evaluate(skeleton_pose & pose)
+{
+    pose.resize(bone_count_);
+
+    float total_weight = 0.f;
+    for (std::size_t i = 0; i < layer_count_; ++i)
+        total_weight += std::max(layers_[i].weight, 0.f);
+
+    if (total_weight <= 0.f)
+    {
+        std::copy(rest_pose_.translations.begin(), rest_pose_.translations.end(), pose.translations.begin());
+        std::copy(rest_pose_.rotations.begin(), rest_pose_.rotations.end(), pose.rotations.begin());
+        std::copy(rest_pose_.scales.begin(), rest_pose_.scales.end(), pose.scales.begin());
+        return;
+    }
+
+    bool first = true;
+    for (std::size_t i = 0; i < layer_count_; ++i)
+    {
+        auto & layer = layers_[i];
+        if (layer.weight <= 0.f)
+            continue;
+
+        layer.sampler.sample(layer.time, layer.pose);
+        assert(layer.pose.size() == bone_count_);
+
+        float const weight = layer.weight / total_weight;
+
+        if (first)
+        {
+            for (std::size_t b = 0; b < bone_count_; ++b)
+            {
+                pose.translations[b] = layer.pose.translations[b] * weight;
+                pose.rotations[b] = layer.pose.rotations[b] * weight;
+                pose.scales[b] = layer.pose.scales[b] * weight;
+            }
+            first = false;
+            continue;
+        }
+
+        for (std::size_t b = 0; b < bone_count_; ++b)
+        {
+            pose.translations[b] += layer.pose.translations[b] * weight;
+            // q and -q are the same rotation; take the one on the side of the sum so far
+            glm::quat const & rotation = layer.pose.rotations[b];
+            float const sign = (glm::dot(pose.rotations[b], rotation) < 0.f) ? -weight : weight;
+            pose.rotations[b] = pose.rotations[b] + rotation * sign;
+            pose.scales[b] += layer.pose.scales[b] * weight;
+        }
+    }
+
+    // The normalized weighted sum of the rotations: close to slerp for two nearby
+    // rotations, and well defined for any number of them
+    for (auto & rotation : pose.rotations)
+        rotation = glm::normalize(rotation);
+}
+
+animation_player::layer * animation_player::find(gltf_model::animation const & animation)
+{
+    for (std::size_t i = 0; i < layer_count_; ++i)
+        if (&layers_[i].sampler.animation() == &animation)
+            return &layers_[i];
+    return nullptr;
+}
+
+animation_player::layer & animation_player::find_or_add(gltf_model::animation const & animation)
+{
+    assert(animation.bones.size() == bone_count_);
+
+    if (auto layer = find(animation))
+        return *layer;
+
+    if (layer_count_ == layers_.size())
+        throw std::runtime_error("Too many animations playing at once, at most " + std::to_string(layers_.size()));
+
+    auto & layer = layers_[layer_count_++];
+    layer.sampler.set_animation(animation);
+    layer.time = 0.f;
+    layer.speed = 1.f;
+    layer.weight = 0.f;
+    layer.target_weight = 0.f;
+    layer.fade_speed = 0.f;
+    return layer;
+}
+
+void animation_player::remove(std::size_t index)
+{
+    // Rotating the removed layer past the active ones keeps the order of the rest and every
+    // layer's storage, so its slot is reused without allocating
+    std::rotate(layers_.begin() + index, layers_.begin() + index + 1, layers_.begin() + layer_count_);
+    --layer_count_;
+}
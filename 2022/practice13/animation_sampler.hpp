@@ -0,0 +1,44 @@
+#pragma once
+
+#include "gltf_loader.hpp"
+#include "skeleton_pose.hpp"
+
+#include <vector>
+#include <cstddef>
+
+// One playing instance of an animation. It remembers which keyframe every
+// channel was at, so that sampling at increasing times walks forward from
+// there instead of searching all keyframes again. Looping or seeking back
+// costs one binary search per channel on the next call.
+// The animation is referenced, not copied, and must outlive the sampler.
+struct animation_sampler
+{
+    // A sampler without an animation, to be given one with set_animation before sampling
+    animation_sampler() = default;
+    explicit animation_sampler(gltf_model::animation const & animation);
+
+    gltf_model::animation const & animation() const { return *animation_; }
+
+    // Switches to another animation and resets the cursors. Doesn't allocate
+    // unless the animation has more bones than any before (or than reserved).
+    void set_animation(gltf_model::animation const & animation);
+    void reserve(std::size_t bone_count) { cursors_.reserve(bone_count); }
+
+    // Channels without keyframes get the bone's rest transform
+    void sample(float time, skeleton_pose & pose);
+
+    // Forgets the cursors, e.g. when switching to a different time line
+    void reset();
+
+private:
+    gltf_model::animation const * animation_ = nullptr;
+
+    struct bone_cursors
+    {
+        std::size_t translation = 0;
+        std::size_t rotation = 0;
+        std::size_t scale = 0;
+    };
+
+    std::vector<bone_cursors> cursors_;
+};
@@ -2,8 +2,10 @@
 
 #include <filesystem>
 #include <vector>
+#include <span>
 #include <string>
 #include <optional>
+#include <cstring>
 #include <unordered_map>
 #include <algorithm>
 
@@ -14,14 +16,20 @@
 #include <glm/gtx/quaternion.hpp>
 #include <glm/gtx/compatibility.hpp>
 
+#include "mapped_file.hpp"
+
 struct gltf_model
 {
     struct buffer_view
     {
         unsigned int offset;
         unsigned int size;
+        // Bytes between consecutive elements of an interleaved view, 0 when they are packed
+        unsigned int stride = 0;
     };
 
+    // An accessor's own byteOffset is folded into its view's offset;
+    // an absent accessor (an optional attribute) has count == 0
     struct accessor
     {
         buffer_view view;
@@ -38,87 +46,239 @@ struct gltf_model
         std::optional<glm::vec4> color;
     };
 
+    // A joint of one or several skins
     struct bone
     {
         unsigned int parent = -1;
         std::string name;
-        glm::mat4 inverse_bind_matrix;
+        // Index into nodes
+        unsigned int node = -1;
+        // nodes[node].transform decomposed, the rest pose of the bone
+        glm::vec3 translation{0.f};
+        glm::quat rotation{1.f, 0.f, 0.f, 0.f};
+        glm::vec3 scale{1.f};
     };
 
-    template <typename T>
+    struct node
+    {
+        std::string name;
+        // Index into nodes, always less than this node's
+        unsigned int parent = -1;
+        // Relative to the parent, in the rest pose
+        glm::mat4 transform{1.f};
+        // parent's world * transform, computed once at load time. Final for static nodes;
+        // for animated ones it is the rest pose, to be recomputed from the animation.
+        glm::mat4 world{1.f};
+        // This node or one of its ancestors is the target of an animation channel
+        bool animated = false;
+        // The primitives of the node's mesh are meshes[first_mesh, first_mesh + mesh_count)
+        unsigned int first_mesh = 0;
+        unsigned int mesh_count = 0;
+        // Index into skins, or -1
+        unsigned int skin = -1;
+    };
+
+    // The palette of a skin has one matrix per joint: the joint's bone world transform
+    // times inverse_bind_matrices[joint]. JOINTS_0 of the skin's meshes index it.
+    struct skin
+    {
+        std::string name;
+        // The bone of every joint
+        std::vector<unsigned int> joints;
+        std::vector<glm::mat4> inverse_bind_matrices;
+    };
+
+    // Keyframes are views into the model's buffer, stored as `Stored` and sampled as `T`
+    template <typename T, typename Stored = T>
     struct spline
     {
-        std::vector<float> timestamps;
-        std::vector<T> values;
+        std::span<float const> timestamps;
+        std::span<Stored const> values;
 
         T operator()(float time) const;
+
+        // The same, but the keyframe search starts from `cursor`, the keyframe found by the
+        // previous call, and updates it. When time only moves forward a little between calls
+        // this is a couple of comparisons; after a jump back (seek, loop) it is a binary search.
+        T operator()(float time, std::size_t & cursor) const;
+
+    private:
+        // `next` is the index of the first keyframe at or after `time`
+        T interpolate(std::size_t next, float time) const;
     };
 
     struct bone_animation
     {
         spline<glm::vec3> translation;
-        spline<glm::quat> rotation;
+        // glTF stores rotations as (x, y, z, w), while glm::quat is (w, x, y, z) in memory
+        spline<glm::quat, glm::vec4> rotation;
         spline<glm::vec3> scale;
+        // What a channel without keyframes stands for: the node's rest transform
+        glm::vec3 rest_translation{0.f};
+        glm::quat rest_rotation{1.f, 0.f, 0.f, 0.f};
+        glm::vec3 rest_scale{1.f};
+    };
+
+    // Channels of animated nodes that are not bones, e.g. rigid props
+    struct node_animation
+    {
+        unsigned int node;
+        bone_animation transform;
     };
 
     struct animation
     {
+        // Indexed like bones
         std::vector<bone_animation> bones;
+        std::vector<node_animation> nodes;
         float max_time = 0.f;
     };
 
+    // One primitive of a glTF mesh; a mesh with several primitives becomes several of these
     struct mesh
     {
         std::string name;
+        // GL_TRIANGLES unless the primitive says otherwise
+        unsigned int mode = 4;
         struct material material;
 
+        // Absent for non-indexed primitives
         accessor indices;
 
         accessor position;
+        // Absent (count == 0) when the file doesn't have them
         accessor normal;
         accessor texcoord;
         accessor joints;
         accessor weights;
     };
 
-    std::vector<char> buffer;
+    // The mapped .bin file, or the whole .glb container, kept for the lifetime of the model
+    mapped_file file;
+    // The binary buffer within it; upload it with glBufferData(buffer.data(), buffer.size())
+    // and read it through accessor_data or attribute_data
+    std::span<char const> buffer;
     std::vector<mesh> meshes;
+    // The whole node hierarchy, flattened so that parents precede their children
+    std::vector<node> nodes;
+    std::vector<skin> skins;
+    // The joints of all skins, parents before children. A mesh's JOINTS_0 index its
+    // node's skin's joints, not these: see skin for how to build the bone matrices.
     std::vector<bone> bones;
     std::unordered_map<std::string, animation> animations;
+
+    // The elements of an accessor `stride` bytes apart, read by copy since
+    // interleaved elements needn't be aligned for T
+    template <typename T>
+    struct strided_view
+    {
+        char const * data = nullptr;
+        std::size_t stride = sizeof(T);
+        std::size_t count = 0;
+
+        std::size_t size() const { return count; }
+
+        T operator[](std::size_t i) const
+        {
+            T value;
+            std::memcpy(&value, data + i * stride, sizeof(T));
+            return value;
+        }
+    };
+
+    // For data glTF never interleaves: indices, keyframes and inverse bind matrices
+    template <typename T>
+    std::span<T const> accessor_data(accessor const & accessor) const
+    {
+        assert(accessor.view.stride == 0 || accessor.view.stride == sizeof(T));
+        assert(accessor.view.offset + accessor.count * sizeof(T) <= buffer.size());
+        return {reinterpret_cast<T const *>(buffer.data() + accessor.view.offset), accessor.count};
+    }
+
+    // For vertex attributes, which may share an interleaved buffer view
+    template <typename T>
+    strided_view<T> attribute_data(accessor const & accessor) const
+    {
+        std::size_t const stride = accessor.view.stride != 0 ? accessor.view.stride : sizeof(T);
+        assert(accessor.count == 0 || accessor.view.offset + (accessor.count - 1) * stride + sizeof(T) <= buffer.size());
+        return {buffer.data() + accessor.view.offset, stride, accessor.count};
+    }
 };
 
+// Loads a .gltf file with a single external buffer, or a binary .glb container.
+// Meshes may have any number of primitives and the model any number of skins;
+// attributes other than POSITION are optional.
 gltf_model load_gltf(std::filesystem::path const & path);
 
+// The skin of every node that has both a mesh and a skin, for the demos, which draw
+// a single bone palette; 0 when no node has one. Throws if the model has no skins,
+// or if meshes are bound to different skins.
+unsigned int drawn_skin(gltf_model const & model);
+
+// How many keyframes a cursor walks forward before it falls back to a binary search
+inline constexpr std::size_t spline_cursor_max_steps = 4;
+
+// std::lower_bound(timestamps, time), starting the search from `cursor`
+inline std::size_t find_keyframe(std::span<float const> timestamps, float time, std::size_t & cursor)
+{
+    std::size_t i = cursor;
+
+    if (i > timestamps.size() || (i > 0 && timestamps[i - 1] >= time))
+        i = std::lower_bound(timestamps.begin(), timestamps.end(), time) - timestamps.begin();
+    else
+    {
+        for (std::size_t steps = 0; i < timestamps.size() && timestamps[i] < time; ++i, ++steps)
+        {
+            if (steps == spline_cursor_max_steps)
+            {
+                i = std::lower_bound(timestamps.begin() + i, timestamps.end(), time) - timestamps.begin();
+                break;
+            }
+        }
+    }
+
+    cursor = i;
+    return i;
+}
+
 template <>
-inline glm::vec3 gltf_model::spline<glm::vec3>::operator()(float time) const
+inline glm::vec3 gltf_model::spline<glm::vec3>::interpolate(std::size_t i, float time) const
 {
     assert(!values.empty());
 
-    auto it = std::lower_bound(timestamps.begin(), timestamps.end(), time);
-    if (it == timestamps.begin())
+    if (i == 0)
         return values.back();
-    if (it == timestamps.end())
+    if (i == timestamps.size())
         return values.back();
 
-    int i = it - timestamps.begin();
-
     float t = (time - timestamps[i - 1]) / (timestamps[i] - timestamps[i - 1]);
     return glm::lerp(values[i - 1], values[i], t);
 }
 
 template <>
-inline glm::quat gltf_model::spline<glm::quat>::operator()(float time) const
+inline glm::quat gltf_model::spline<glm::quat, glm::vec4>::interpolate(std::size_t i, float time) const
 {
     assert(!values.empty());
 
-    auto it = std::lower_bound(timestamps.begin(), timestamps.end(), time);
-    if (it == timestamps.begin())
-        return values.back();
-    if (it == timestamps.end())
-        return values.back();
+    auto to_quat = [](glm::vec4 const & v){ return glm::quat(v.w, v.x, v.y, v.z); };
 
-    int i = it - timestamps.begin();
+    if (i == 0)
+        return to_quat(values.back());
+    if (i == timestamps.size())
+        return to_quat(values.back());
 
     float t = (time - timestamps[i - 1]) / (timestamps[i] - timestamps[i - 1]);
-    return glm::slerp(values[i - 1], values[i], t);
+    return glm::slerp(to_quat(values[i - 1]), to_quat(values[i]), t);
+}
+
+template <typename T, typename Stored>
+T gltf_model::spline<T, Stored>::operator()(float time) const
+{
+    return interpolate(std::lower_bound(timestamps.begin(), timestamps.end(), time) - timestamps.begin(), time);
+}
+
+template <typename T, typename Stored>
+T gltf_model::spline<T, Stored>::operator()(float time, std::size_t & cursor) const
+{
+    return interpolate(find_keyframe(timestamps, time, cursor), time);
 }
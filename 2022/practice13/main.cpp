@@ -28,6 +28,8 @@
 #include <glm/gtx/string_cast.hpp>
 
 #include "gltf_loader.hpp"
+#include "animation_player.hpp"
+#include "skeleton_evaluator.hpp"
 #include "stb_image.h"
 
 std::string to_string(std::string_view str)
@@ -213,11 +215,15 @@ int main() try
 
     auto setup_attribute = [](int index, gltf_model::accessor const & accessor, bool integer = false)
     {
+        // Absent attributes are left disabled and read as the constant (0, 0, 0, 1)
+        if (accessor.count == 0)
+            return;
+
         glEnableVertexAttribArray(index);
         if (integer)
-            glVertexAttribIPointer(index, accessor.size, accessor.type, 0, reinterpret_cast<void *>(accessor.view.offset));
+            glVertexAttribIPointer(index, accessor.size, accessor.type, accessor.view.stride, reinterpret_cast<void *>(accessor.view.offset));
         else
-            glVertexAttribPointer(index, accessor.size, accessor.type, GL_FALSE, 0, reinterpret_cast<void *>(accessor.view.offset));
+            glVertexAttribPointer(index, accessor.size, accessor.type, GL_FALSE, accessor.view.stride, reinterpret_cast<void *>(accessor.view.offset));
     };
 
     std::vector<mesh> meshes;
@@ -269,6 +275,18 @@ int main() try
     float time = 0.f;
     float animation_interpolation = 0;
 
+    // LEFT and RIGHT blend between running and walking
+    auto const & run_animation = input_model.animations.at("01_Run");
+    auto const & walk_animation = input_model.animations.at("02_walk");
+
+    animation_player player(input_model.bones);
+    player.set_weight(run_animation, 1.f);
+    player.set_weight(walk_animation, 0.f);
+
+    skeleton_evaluator skeleton(input_model.bones, input_model.skins[drawn_skin(input_model)]);
+    skeleton_pose pose;
+    std::vector<glm::mat4x3> bones(skeleton.size(), glm::mat4x3(1));
+
     std::map<SDL_Keycode, bool> button_down;
 
     float view_angle = glm::pi<float>() / 8.f;
@@ -368,42 +386,19 @@ int main() try
 
         glm::vec3 light_direction = glm::normalize(glm::vec3(1.f, 2.f, 3.f));
 
-        std::vector<glm::mat4x3> bones(input_model.bones.size(), glm::mat4x3(1));
-
-        auto run_animation = input_model.animations.at("01_Run");
-        auto walk_animation = input_model.animations.at("02_walk");
-
-        auto run_frame = std::fmod(time, run_animation.max_time);
-        auto walk_frame = std::fmod(time, walk_animation.max_time);
-
-        for (int bone_index = 0; bone_index < input_model.bones.size(); bone_index++) {
-            auto run_translation = run_animation.bones[bone_index].translation(run_frame);
-            auto walk_translation = walk_animation.bones[bone_index].translation(walk_frame);
-            auto translation = glm::translate(glm::mat4(1.f), glm::lerp((run_translation), (walk_translation), animation_interpolation));
-
-            auto run_rotation = run_animation.bones[bone_index].rotation(run_frame);
-            auto walk_rotation = walk_animation.bones[bone_index].rotation(walk_frame);
-            auto rotation = glm::toMat4(glm::slerp(run_rotation, walk_rotation, animation_interpolation));
-
-            auto run_scale = glm::scale(glm::mat4(1.f), run_animation.bones[bone_index].scale(run_frame));
-            auto walk_scale = glm::scale(glm::mat4(1.f), walk_animation.bones[bone_index].scale(walk_frame));
-            auto scale = glm::toMat4(glm::slerp(glm::quat_cast(run_scale), glm::quat_cast(walk_scale), animation_interpolation));
-            glm::mat4 transform = translation * rotation * scale;
-            bones[bone_index] = transform;
-            if (input_model.bones[bone_index].parent != -1) {
-                bones[bone_index] = bones[input_model.bones[bone_index].parent] * transform;
-            }
-        }
-        for (int bone_index = 0; bone_index < input_model.bones.size(); bone_index++) {
-            bones[bone_index] = bones[bone_index] * input_model.bones[bone_index].inverse_bind_matrix;
-        }
+        player.set_weight(run_animation, 1.f - animation_interpolation);
+        player.set_weight(walk_animation, animation_interpolation);
+        if (!paused)
+            player.update(dt);
+        player.evaluate(pose);
+        skeleton.evaluate(pose, bones);
 
         glUseProgram(program);
         glUniformMatrix4fv(model_location, 1, GL_FALSE, reinterpret_cast<float *>(&model));
         glUniformMatrix4fv(view_location, 1, GL_FALSE, reinterpret_cast<float *>(&view));
         glUniformMatrix4fv(projection_location, 1, GL_FALSE, reinterpret_cast<float *>(&projection));
         glUniform3fv(light_direction_location, 1, reinterpret_cast<float *>(&light_direction));
-        glUniformMatrix4x3fv(bones_location, input_model.bones.size(), GL_FALSE, reinterpret_cast<float *>(bones.data()));
+        glUniformMatrix4x3fv(bones_location, bones.size(), GL_FALSE, reinterpret_cast<float *>(bones.data()));
 
         auto draw_meshes = [&](bool transparent)
         {
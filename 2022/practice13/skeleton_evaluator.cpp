@@ -0,0 +1,296 @@
+#include "skeleton_evaluator.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SKELETON_EVALUATOR_SSE
+#include <immintrin.h>
+#endif
+
+namespace
+{
+
+    constexpr std::uint32_t no_parent = -1;
+
+    using affine = skeleton_evaluator::affine;
+
+    affine to_affine(glm::mat4 const & m)
+    {
+        affine result;
+        for (int c = 0; c < 4; ++c)
+        {
+            for (int r = 0; r < 3; ++r)
+                result.columns[c][r] = m[c][r];
+            result.columns[c][3] = 0.f;
+        }
+        return result;
+    }
+
+    // The same as glm::translate * glm::toMat4 * glm::scale for a normalized rotation
+    affine local_transform(glm::vec3 const & t, glm::quat const & q, glm::vec3 const & s)
+    {
+        float const xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+        float const xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+        float const wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+
+        return {{
+            {s.x * (1.f - 2.f * (yy + zz)), s.x * 2.f * (xy + wz), s.x * 2.f * (xz - wy), 0.f},
+            {s.y * 2.f * (xy - wz), s.y * (1.f - 2.f * (xx + zz)), s.y * 2.f * (yz + wx), 0.f},
+            {s.z * 2.f * (xz + wy), s.z * 2.f * (yz - wx), s.z * (1.f - 2.f * (xx + yy)), 0.f},
+            {t.x, t.y, t.z, 0.f},
+        }};
+    }
+
+#ifdef SKELETON_EVALUATOR_SSE
+
+    // Writes the lanes of four bones as columns: rows[c][r] holds row r of column c
+    void store_columns(__m128 const (&rows)[4][3], affine * output)
+    {
+        __m128 const zero = _mm_setzero_ps();
+        for (int c = 0; c < 4; ++c)
+        {
+            __m128 r0 = rows[c][0], r1 = rows[c][1], r2 = rows[c][2], r3 = zero;
+            _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+            _mm_store_ps(output[0].columns[c], r0);
+            _mm_store_ps(output[1].columns[c], r1);
+            _mm_store_ps(output[2].columns[c], r2);
+            _mm_store_ps(output[3].columns[c], r3);
+        }
+    }
+
+#ifdef __AVX__
+
+    constexpr std::size_t lane_count = 8;
+
+    using lanes = __m256;
+
+    // Rows of the 3x4 matrices of lane_count bones, one bone per lane
+    struct local_lanes
+    {
+        lanes m[4][3];
+    };
+
+    inline lanes add(lanes a, lanes b) { return _mm256_add_ps(a, b); }
+    inline lanes sub(lanes a, lanes b) { return _mm256_sub_ps(a, b); }
+    inline lanes mul(lanes a, lanes b) { return _mm256_mul_ps(a, b); }
+    inline lanes broadcast(float value) { return _mm256_set1_ps(value); }
+
+    template <typename Get>
+    lanes gather(std::size_t first, Get && get)
+    {
+        return _mm256_setr_ps(get(first), get(first + 1), get(first + 2), get(first + 3),
+            get(first + 4), get(first + 5), get(first + 6), get(first + 7));
+    }
+
+    void store(local_lanes const & local, affine * output)
+    {
+        __m128 low[4][3], high[4][3];
+        for (int c = 0; c < 4; ++c)
+        {
+            for (int r = 0; r < 3; ++r)
+            {
+                low[c][r] = _mm256_castps256_ps128(local.m[c][r]);
+                high[c][r] = _mm256_extractf128_ps(local.m[c][r], 1);
+            }
+        }
+        store_columns(low, output);
+        store_columns(high, output + 4);
+    }
+
+#else
+
+    constexpr std::size_t lane_count = 4;
+
+    using lanes = __m128;
+
+    struct local_lanes
+    {
+        lanes m[4][3];
+    };
+
+    inline lanes add(lanes a, lanes b) { return _mm_add_ps(a, b); }
+    inline lanes sub(lanes a, lanes b) { return _mm_sub_ps(a, b); }
+    inline lanes mul(lanes a, lanes b) { return _mm_mul_ps(a, b); }
+    inline lanes broadcast(float value) { return _mm_set1_ps(value); }
+
+    template <typename Get>
+    lanes gather(std::size_t first, Get && get)
+    {
+        return _mm_setr_ps(get(first), get(first + 1), get(first + 2), get(first + 3));
+    }
+
+    void store(local_lanes const & local, affine * output)
+    {
+        store_columns(local.m, output);
+    }
+
+#endif
+
+    // local_transform for lane_count bones starting at `first`
+    void local_transforms(skeleton_pose const & pose, std::size_t first, affine * output)
+    {
+        lanes const tx = gather(first, [&](std::size_t i){ return pose.translations[i].x; });
+        lanes const ty = gather(first, [&](std::size_t i){ return pose.translations[i].y; });
+        lanes const tz = gather(first, [&](std::size_t i){ return pose.translations[i].z; });
+        lanes const qx = gather(first, [&](std::size_t i){ return pose.rotations[i].x; });
+        lanes const qy = gather(first, [&](std::size_t i){ return pose.rotations[i].y; });
+        lanes const qz = gather(first, [&](std::size_t i){ return pose.rotations[i].z; });
+        lanes const qw = gather(first, [&](std::size_t i){ return pose.rotations[i].w; });
+        lanes const sx = gather(first, [&](std::size_t i){ return pose.scales[i].x; });
+        lanes const sy = gather(first, [&](std::size_t i){ return pose.scales[i].y; });
+        lanes const sz = gather(first, [&](std::size_t i){ return pose.scales[i].z; });
+
+        lanes const one = broadcast(1.f);
+        lanes const two = broadcast(2.f);
+
+        lanes const x2 = mul(qx, two), y2 = mul(qy, two), z2 = mul(qz, two);
+        lanes const xx = mul(qx, x2), yy = mul(qy, y2), zz = mul(qz, z2);
+        lanes const xy = mul(qx, y2), xz = mul(qx, z2), yz = mul(qy, z2);
+        lanes const wx = mul(qw, x2), wy = mul(qw, y2), wz = mul(qw, z2);
+
+        local_lanes local;
+        local.m[0][0] = mul(sx, sub(one, add(yy, zz)));
+        local.m[0][1] = mul(sx, add(xy, wz));
+        local.m[0][2] = mul(sx, sub(xz, wy));
+        local.m[1][0] = mul(sy, sub(xy, wz));
+        local.m[1][1] = mul(sy, sub(one, add(xx, zz)));
+        local.m[1][2] = mul(sy, add(yz, wx));
+        local.m[2][0] = mul(sz, add(xz, wy));
+        local.m[2][1] = mul(sz, sub(yz, wx));
+        local.m[2][2] = mul(sz, sub(one, add(xx, yy)));
+        local.m[3][0] = tx;
+        local.m[3][1] = ty;
+        local.m[3][2] = tz;
+
+        store(local, output);
+    }
+
+    // a * b for affine transforms
+    void multiply(affine const & a, affine const & b, __m128 (&result)[4])
+    {
+        __m128 const a0 = _mm_load_ps(a.columns[0]);
+        __m128 const a1 = _mm_load_ps(a.columns[1]);
+        __m128 const a2 = _mm_load_ps(a.columns[2]);
+        __m128 const a3 = _mm_load_ps(a.columns[3]);
+
+        for (int c = 0; c < 4; ++c)
+        {
+            __m128 column = _mm_add_ps(_mm_add_ps(
+                _mm_mul_ps(a0, _mm_set1_ps(b.columns[c][0])),
+                _mm_mul_ps(a1, _mm_set1_ps(b.columns[c][1]))),
+                _mm_mul_ps(a2, _mm_set1_ps(b.columns[c][2])));
+            result[c] = (c == 3) ? _mm_add_ps(column, a3) : column;
+        }
+    }
+
+    void store(__m128 const (&columns)[4], affine & output)
+    {
+        for (int c = 0; c < 4; ++c)
+            _mm_store_ps(output.columns[c], columns[c]);
+    }
+
+    // glm::mat4x3 is twelve tightly packed floats: each column is stored with four
+    // floats, the extra one being overwritten by the next column, except the last
+    void store(__m128 const (&columns)[4], glm::mat4x3 & output)
+    {
+        float * data = &output[0][0];
+        _mm_storeu_ps(data, columns[0]);
+        _mm_storeu_ps(data + 3, columns[1]);
+        _mm_storeu_ps(data + 6, columns[2]);
+        _mm_storel_pi(reinterpret_cast<__m64 *>(data + 9), columns[3]);
+        _mm_store_ss(data + 11, _mm_movehl_ps(columns[3], columns[3]));
+    }
+
+#else
+
+    constexpr std::size_t lane_count = 1;
+
+    void local_transforms(skeleton_pose const & pose, std::size_t first, affine * output)
+    {
+        *output = local_transform(pose.translations[first], pose.rotations[first], pose.scales[first]);
+    }
+
+    void multiply(affine const & a, affine const & b, float (&result)[4][4])
+    {
+        for (int c = 0; c < 4; ++c)
+        {
+            for (int r = 0; r < 4; ++r)
+            {
+                result[c][r] = a.columns[0][r] * b.columns[c][0] + a.columns[1][r] * b.columns[c][1]
+                    + a.columns[2][r] * b.columns[c][2] + ((c == 3) ? a.columns[3][r] : 0.f);
+            }
+        }
+    }
+
+    void store(float const (&columns)[4][4], affine & output)
+    {
+        for (int c = 0; c < 4; ++c)
+            for (int r = 0; r < 4; ++r)
+                output.columns[c][r] = columns[c][r];
+    }
+
+    void store(float const (&columns)[4][4], glm::mat4x3 & output)
+    {
+        for (int c = 0; c < 4; ++c)
+            for (int r = 0; r < 3; ++r)
+                output[c][r] = columns[c][r];
+    }
+
+#endif
+
+}
+
+skeleton_evaluator::skeleton_evaluator(std::span<gltf_model::bone const> bones, gltf_model::skin const & skin)
+    : joints_(skin.joints.begin(), skin.joints.end())
+    , locals_(bones.size())
+    , worlds_(bones.size())
+{
+    parents_.reserve(bones.size());
+    for (auto const & bone : bones)
+    {
+        assert(bone.parent == no_parent || bone.parent < parents_.size());
+        parents_.push_back(bone.parent);
+    }
+
+    assert(skin.inverse_bind_matrices.size() == joints_.size());
+    inverse_bind_matrices_.reserve(joints_.size());
+    for (std::size_t j = 0; j < joints_.size(); ++j)
+    {
+        assert(joints_[j] < bones.size());
+        inverse_bind_matrices_.push_back(to_affine(skin.inverse_bind_matrices[j]));
+    }
+}
+
+void skeleton_evaluator::evaluate(skeleton_pose const & pose, std::span<glm::mat4x3> palette)
+{
+    std::size_t const bone_count = parents_.size();
+    assert(pose.size() == bone_count);
+    assert(palette.size() == joints_.size());
+
+    std::size_t i = 0;
+    for (; i + lane_count <= bone_count; i += lane_count)
+        local_transforms(pose, i, locals_.data() + i);
+    for (; i < bone_count; ++i)
+        locals_[i] = local_transform(pose.translations[i], pose.rotations[i], pose.scales[i]);
+
+#ifdef SKELETON_EVALUATOR_SSE
+    __m128 columns[4];
+#else
+    float columns[4][4];
+#endif
+
+    for (std::size_t i = 0; i < bone_count; ++i)
+    {
+        if (parents_[i] == no_parent)
+            worlds_[i] = locals_[i];
+        else
+        {
+            multiply(worlds_[parents_[i]], locals_[i], columns);
+            store(columns, worlds_[i]);
+        }
+    }
+
+    for (std::size_t j = 0; j < joints_.size(); ++j)
+    {
+        multiply(worlds_[joints_[j]], inverse_bind_matrices_[j], columns);
+        store(columns, palette[j]);
+    }
+}
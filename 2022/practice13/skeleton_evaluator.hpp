@@ -0,0 +1,45 @@
+#pragma once
+
+#include "gltf_loader.hpp"
+#include "skeleton_pose.hpp"
+
+#include <vector>
+#include <span>
+#include <cstdint>
+
+#include <glm/mat4x3.hpp>
+
+// Turns a skeleton pose into the palette of one skin, the matrices uploaded to the
+// `bones` uniform: the world transform of the bone of joint j (parent_world *
+// translate * rotate * scale) times the skin's inverse_bind_matrices[j], for every
+// joint j, as the JOINTS_0 of the skin's meshes index them.
+// The local transforms are built for several bones at once with SSE (or AVX, when
+// compiled with it), and the world transforms in a single pass over the bones,
+// relying on parents preceding their children (as load_gltf checks).
+struct skeleton_evaluator
+{
+    skeleton_evaluator(std::span<gltf_model::bone const> bones, gltf_model::skin const & skin);
+
+    std::size_t bone_count() const { return parents_.size(); }
+    // The number of matrices in the palette, one per joint of the skin
+    std::size_t size() const { return joints_.size(); }
+
+    // `pose` must have bone_count() bones and `palette` size() elements;
+    // the rotations are expected to be normalized
+    void evaluate(skeleton_pose const & pose, std::span<glm::mat4x3> palette);
+
+    // An affine transform as four columns, the fourth component of each unused
+    struct alignas(16) affine
+    {
+        float columns[4][4];
+    };
+
+private:
+    std::vector<std::uint32_t> parents_;
+    // The bone and the inverse bind matrix of every joint of the skin
+    std::vector<std::uint32_t> joints_;
+    std::vector<affine> inverse_bind_matrices_;
+    // Scratch storage, sized once in the constructor
+    std::vector<affine> locals_;
+    std::vector<affine> worlds_;
+};
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+
+#define GLM_FORCE_SWIZZLE
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/vec3.hpp>
+#include <glm/gtx/quaternion.hpp>
+
+// Local bone transforms of a whole skeleton, one array per channel,
+// indexed like gltf_model::bones
+struct skeleton_pose
+{
+    std::vector<glm::vec3> translations;
+    std::vector<glm::quat> rotations;
+    std::vector<glm::vec3> scales;
+
+    std::size_t size() const { return translations.size(); }
+
+    // Keeps the capacity, so resizing to the same skeleton again doesn't allocate
+    void resize(std::size_t bone_count)
+    {
+        translations.resize(bone_count);
+        rotations.resize(bone_count);
+        scales.resize(bone_count);
+    }
+};
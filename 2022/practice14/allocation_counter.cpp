@@ -0,0 +1,55 @@
+#include "allocation_counter.hpp"
+
+#include <cstdlib>
+#include <new>
+#include <atomic>
+
+namespace
+{
+
+	std::atomic<std::size_t> count{0};
+
+	void * allocate(std::size_t size)
+	{
+		++count;
+		if (void * result = std::malloc(size ? size : 1))
+			return result;
+		throw std::bad_alloc();
+	}
+
+}
+
+std::size_t allocation_count()
+{
+	return count;
+}
+
+void * operator new(std::size_t size)
+{
+	return allocate(size);
+}
+
+void * operator new[](std::size_t size)
+{
+	return allocate(size);
+}
+
+void operator delete(void * pointer) noexcept
+{
+	std::free(pointer);
+}
+
+void operator delete[](void * pointer) noexcept
+{
+	std::free(pointer);
+}
+
+void operator delete(void * pointer, std::size_t) noexcept
+{
+	std::free(pointer);
+}
+
+void operator delete[](void * pointer, std::size_t) noexcept
+{
+	std::free(pointer);
+}
@@ -0,0 +1,172 @@
+#include "gltf_loader.hpp"
+#include "frustum_culling.hpp"
+#include "instance_bvh.hpp"
+
+#include <glm/ext/matrix_transform.hpp>
+#include <glm/ext/matrix_clip_space.hpp>
+#include <glm/ext/scalar_constants.hpp>
+
+#include <iostream>
+#include <chrono>
+#include <string>
+#include <random>
+#include <cstdlib>
+#include <algorithm>
+#include <cmath>
+
+// Usage: bvh_benchmark [--iterations N] [--instances N]... [file.gltf]
+// Places the given numbers of instances of the model's first mesh on a square grid,
+// as practice14 does, builds an instance_bvh over them, and culls them against the
+// frustums of a camera turning around near the middle of the grid: with the flat
+// SIMD plane test and through the tree. Then moves every instance a little, refits
+// the tree and culls again. Prints the times per frame (one view) and checks that
+// the tree keeps exactly the boxes the flat test keeps.
+
+namespace
+{
+
+	constexpr int view_count = 8;
+
+	template <typename Pass>
+	double measure(int iterations, Pass && pass)
+	{
+		double best_time = 1e30;
+		for (int i = 0; i < iterations; ++i)
+		{
+			auto start = std::chrono::high_resolution_clock::now();
+			pass();
+			auto end = std::chrono::high_resolution_clock::now();
+
+			best_time = std::min(best_time, std::chrono::duration_cast<std::chrono::duration<double>>(end - start).count());
+		}
+		return best_time;
+	}
+
+	std::vector<frustum> make_views()
+	{
+		std::vector<frustum> result;
+		glm::mat4 const projection = glm::perspective(glm::pi<float>() / 2.f, 16.f / 9.f, 0.1f, 100.f);
+		for (int v = 0; v < view_count; ++v)
+		{
+			glm::mat4 view(1.f);
+			view = glm::rotate(view, 2.f * glm::pi<float>() * v / view_count, {0.f, 1.f, 0.f});
+			view = glm::translate(view, -glm::vec3(0.3f, 1.5f, 3.f));
+			result.emplace_back(projection * view);
+		}
+		return result;
+	}
+
+	// Whether the two cullings kept the same boxes, in whatever order
+	bool same_set(std::vector<std::uint32_t> & a, std::size_t a_count, std::vector<std::uint32_t> & b, std::size_t b_count)
+	{
+		std::sort(a.begin(), a.begin() + a_count);
+		std::sort(b.begin(), b.begin() + b_count);
+		return a_count == b_count && std::equal(a.begin(), a.begin() + a_count, b.begin());
+	}
+
+}
+
+int main(int argc, char ** argv) try
+{
+	int iterations = 5;
+	std::vector<std::size_t> instance_counts;
+	std::filesystem::path path = PROJECT_ROOT "/bunny/bunny.gltf";
+
+	for (int i = 1; i < argc; ++i)
+	{
+		if (argv[i] == std::string("--iterations") && i + 1 < argc)
+			iterations = std::max(1, std::atoi(argv[++i]));
+		else if (argv[i] == std::string("--instances") && i + 1 < argc)
+			instance_counts.push_back(std::max(1ll, std::atoll(argv[++i])));
+		else
+			path = argv[i];
+	}
+
+	if (instance_counts.empty())
+		instance_counts = {10000, 100000, 1000000};
+
+	auto const model = load_gltf(path);
+	if (model.meshes.empty())
+		throw std::runtime_error("No meshes in " + path.string());
+
+	glm::vec3 const mesh_min = model.meshes[0].min;
+	glm::vec3 const mesh_max = model.meshes[0].max;
+
+	auto const views = make_views();
+
+	std::cout << path.string() << ", " << view_count << " views\n";
+
+	for (std::size_t instance_count : instance_counts)
+	{
+		std::size_t const side = std::ceil(std::sqrt(static_cast<double>(instance_count)));
+
+		std::vector<glm::vec3> offsets(instance_count);
+		instance_bounds bounds;
+		bounds.reserve(instance_count);
+		for (std::size_t i = 0; i < instance_count; ++i)
+		{
+			offsets[i] = {float(i % side) - side / 2, 0.f, float(i / side) - side / 2};
+			bounds.push_back(mesh_min + offsets[i], mesh_max + offsets[i]);
+		}
+
+		instance_bvh bvh;
+		double const build_time = measure(iterations, [&]{ bvh.build(bounds); });
+
+		std::vector<std::uint32_t> visible(instance_count), reference(instance_count);
+		std::size_t visible_count = 0;
+
+		double const flat_time = measure(iterations, [&]{
+			for (auto const & f : views)
+				visible_count += cull_planes(f, bounds, visible);
+		});
+		double const bvh_time = measure(iterations, [&]{
+			for (auto const & f : views)
+				visible_count += bvh.cull(f, bounds, visible);
+		});
+
+		std::size_t mismatches = 0;
+		std::size_t total_visible = 0;
+		auto check = [&]{
+			for (auto const & f : views)
+			{
+				std::size_t const count = bvh.cull(f, bounds, visible);
+				std::size_t const reference_count = cull_planes(f, bounds, reference);
+				total_visible += count;
+				mismatches += !same_set(visible, count, reference, reference_count);
+			}
+		};
+		check();
+
+		// Every instance moves a bit, as a crowd would between frames
+		std::default_random_engine rng;
+		std::uniform_real_distribution<float> jitter(-0.25f, 0.25f);
+		for (std::size_t i = 0; i < instance_count; ++i)
+		{
+			glm::vec3 const offset = offsets[i] + glm::vec3(jitter(rng), jitter(rng), jitter(rng));
+			bounds.set(i, mesh_min + offset, mesh_max + offset);
+		}
+
+		double const refit_time = measure(iterations, [&]{ bvh.refit(bounds); });
+		double const refit_cull_time = measure(iterations, [&]{
+			for (auto const & f : views)
+				visible_count += bvh.cull(f, bounds, visible);
+		});
+		check();
+
+		std::cout << "  " << instance_count << " instances\n";
+		std::cout << "    nodes:                " << bvh.node_count() << " (depth " << bvh.depth() << ")\n";
+		std::cout << "    visible:              " << total_visible / (2 * view_count) << '\n';
+		std::cout << "    build:                " << build_time * 1000.0 << " ms\n";
+		std::cout << "    refit:                " << refit_time * 1000.0 << " ms\n";
+		std::cout << "    flat planes:          " << flat_time * 1e6 / view_count << " us/frame\n";
+		std::cout << "    bvh:                  " << bvh_time * 1e6 / view_count << " us/frame\n";
+		std::cout << "    bvh, refit:           " << refit_cull_time * 1e6 / view_count << " us/frame\n";
+		std::cout << "    mismatches:           " << mismatches << '\n';
+		std::cout << "    checksum:             " << visible_count << '\n';
+	}
+}
+catch (std::exception const & e)
+{
+	std::cerr << e.what() << std::endl;
+	return EXIT_FAILURE;
+}
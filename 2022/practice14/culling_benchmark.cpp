@@ -0,0 +1,178 @@
+#include "gltf_loader.hpp"
+#include "frustum_culling.hpp"
+#include "intersect.hpp"
+
+#include <glm/ext/matrix_transform.hpp>
+#include <glm/ext/matrix_clip_space.hpp>
+#include <glm/ext/scalar_constants.hpp>
+
+#include <iostream>
+#include <chrono>
+#include <string>
+#include <cstdlib>
+#include <algorithm>
+#include <cmath>
+
+// Usage: culling_benchmark [--iterations N] [--instances N]... [file.gltf]
+// Places the given numbers of instances of the model's first mesh on a square grid,
+// as practice14 does, and culls them against the frustums of a camera turning around
+// near the middle of the grid: with the separating axis test of every box, with the
+// frustum planes one box at a time, with the SIMD plane test, and exactly (planes,
+// then the separating axis test of the boxes that straddle a plane). Prints the cost
+// per instance and checks that the SIMD and exact results match their references.
+// The separating axis test of every box is slow, so on large grids it only runs on
+// an evenly spread sample of the boxes.
+
+namespace
+{
+
+	constexpr int view_count = 8;
+	constexpr std::size_t max_sat_tests = 100000;
+
+	template <typename Pass>
+	double measure(int iterations, Pass && pass)
+	{
+		double best_time = 1e30;
+		for (int i = 0; i < iterations; ++i)
+		{
+			auto start = std::chrono::high_resolution_clock::now();
+			pass();
+			auto end = std::chrono::high_resolution_clock::now();
+
+			best_time = std::min(best_time, std::chrono::duration_cast<std::chrono::duration<double>>(end - start).count());
+		}
+		return best_time;
+	}
+
+	std::vector<frustum> make_views()
+	{
+		std::vector<frustum> result;
+		glm::mat4 const projection = glm::perspective(glm::pi<float>() / 2.f, 16.f / 9.f, 0.1f, 100.f);
+		for (int v = 0; v < view_count; ++v)
+		{
+			glm::mat4 view(1.f);
+			view = glm::rotate(view, 2.f * glm::pi<float>() * v / view_count, {0.f, 1.f, 0.f});
+			view = glm::translate(view, -glm::vec3(0.3f, 1.5f, 3.f));
+			result.emplace_back(projection * view);
+		}
+		return result;
+	}
+
+}
+
+int main(int argc, char ** argv) try
+{
+	int iterations = 5;
+	std::vector<std::size_t> instance_counts;
+	std::filesystem::path path = PROJECT_ROOT "/bunny/bunny.gltf";
+
+	for (int i = 1; i < argc; ++i)
+	{
+		if (argv[i] == std::string("--iterations") && i + 1 < argc)
+			iterations = std::max(1, std::atoi(argv[++i]));
+		else if (argv[i] == std::string("--instances") && i + 1 < argc)
+			instance_counts.push_back(std::max(1ll, std::atoll(argv[++i])));
+		else
+			path = argv[i];
+	}
+
+	if (instance_counts.empty())
+		instance_counts = {100000, 1000000, 10000000};
+
+	auto const model = load_gltf(path);
+	if (model.meshes.empty())
+		throw std::runtime_error("No meshes in " + path.string());
+
+	glm::vec3 const mesh_min = model.meshes[0].min;
+	glm::vec3 const mesh_max = model.meshes[0].max;
+
+	auto const views = make_views();
+
+	std::cout << path.string() << ", " << view_count << " views, "
+#if defined(__AVX__)
+		<< "AVX"
+#elif defined(__SSE2__) || defined(_M_X64)
+		<< "SSE"
+#else
+		<< "no SIMD"
+#endif
+		<< '\n';
+
+	for (std::size_t instance_count : instance_counts)
+	{
+		std::size_t const side = std::ceil(std::sqrt(static_cast<double>(instance_count)));
+
+		instance_bounds bounds;
+		bounds.reserve(instance_count);
+		for (std::size_t i = 0; i < instance_count; ++i)
+		{
+			glm::vec3 const offset{float(i % side) - side / 2, 0.f, float(i / side) - side / 2};
+			bounds.push_back(mesh_min + offset, mesh_max + offset);
+		}
+
+		std::vector<std::uint32_t> visible(instance_count), reference(instance_count);
+		std::size_t visible_count = 0, exact_count = 0;
+
+		double const scalar_time = measure(iterations, [&]{
+			for (auto const & f : views)
+				visible_count += cull_planes_scalar(f, bounds, visible);
+		});
+		double const simd_time = measure(iterations, [&]{
+			for (auto const & f : views)
+				visible_count += cull_planes(f, bounds, visible);
+		});
+		double const exact_time = measure(iterations, [&]{
+			for (auto const & f : views)
+				exact_count += cull_exact(f, bounds, visible);
+		});
+
+		std::size_t const sat_stride = std::max<std::size_t>(1, instance_count / max_sat_tests);
+		std::size_t sat_count = 0;
+		double const sat_time = measure(iterations, [&]{
+			for (auto const & f : views)
+				for (std::size_t i = 0; i < instance_count; i += sat_stride)
+					sat_count += intersect(f, bounds.box(i));
+		});
+		std::size_t const sat_tests = (instance_count + sat_stride - 1) / sat_stride;
+
+		// The SIMD kernel must keep exactly the boxes the scalar one keeps, and the exact
+		// culling exactly the boxes the separating axis test finds
+		std::size_t simd_mismatches = 0, exact_mismatches = 0;
+		std::size_t planes_visible = 0, exact_visible = 0;
+		for (auto const & f : views)
+		{
+			std::size_t const count = cull_planes(f, bounds, visible);
+			std::size_t const reference_count = cull_planes_scalar(f, bounds, reference);
+			planes_visible += count;
+			if (count != reference_count || !std::equal(visible.begin(), visible.begin() + count, reference.begin()))
+				++simd_mismatches;
+
+			std::size_t const exact = cull_exact(f, bounds, visible);
+			exact_visible += exact;
+			std::vector<bool> is_visible(instance_count, false);
+			for (std::size_t c = 0; c < exact; ++c)
+				is_visible[visible[c]] = true;
+			for (std::size_t i = 0; i < instance_count; i += sat_stride)
+				exact_mismatches += (is_visible[i] != intersect(f, bounds.box(i)));
+		}
+
+		double const per_instance = 1e9 / (double(instance_count) * view_count);
+
+		std::cout << "  " << instance_count << " instances\n";
+		std::cout << "    visible, planes:      " << planes_visible / view_count << '\n';
+		std::cout << "    visible, exact:       " << exact_visible / view_count << '\n';
+		std::cout << "    separating axes:      " << sat_time * 1e9 / (double(sat_tests) * view_count) << " ns/instance"
+			<< (sat_stride > 1 ? " (every " + std::to_string(sat_stride) + "th)" : std::string()) << '\n';
+		std::cout << "    planes, scalar:       " << scalar_time * per_instance << " ns/instance\n";
+		std::cout << "    planes, simd:         " << simd_time * per_instance << " ns/instance\n";
+		std::cout << "    exact:                " << exact_time * per_instance << " ns/instance\n";
+		std::cout << "    simd mismatches:      " << simd_mismatches << '\n';
+		std::cout << "    exact mismatches:     " << exact_mismatches << '\n';
+		std::cout << "    checksum:             " << visible_count + exact_count + sat_count << '\n';
+	}
+}
+catch (std::exception const & e)
+{
+	std::cerr << e.what() << std::endl;
+	return EXIT_FAILURE;
+}
@@ -44,4 +44,23 @@ frustum::frustum(glm::mat4 const & view_projection)
 		e(2, 6),
 		e(3, 7),
 	};
+
+	// Rows of the view-projection matrix combined as in Gribb & Hartmann:
+	// -w <= x <= w gives the left and right planes, and so on for y and z
+	auto row = [&](int r)
+	{
+		return glm::vec4(view_projection[0][r], view_projection[1][r], view_projection[2][r], view_projection[3][r]);
+	};
+
+	planes = {
+		row(3) + row(0),
+		row(3) - row(0),
+		row(3) + row(1),
+		row(3) - row(1),
+		row(3) + row(2),
+		row(3) - row(2),
+	};
+
+	for (auto & plane : planes)
+		plane /= glm::length(glm::vec3(plane));
 }
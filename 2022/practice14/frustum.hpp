@@ -1,6 +1,7 @@
 #pragma once
 
 #include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
 #include <glm/mat4x4.hpp>
 
 #include <array>
@@ -11,5 +12,10 @@ struct frustum
 	std::array<glm::vec3, 5> face_normals;
 	std::array<glm::vec3, 6> edge_directions;
 
+	// Left, right, bottom, top, near, far: a point p is on the inner side of a plane
+	// when dot(plane.xyz, p) + plane.w >= 0, and plane.xyz has unit length, so that
+	// this is the distance to the plane
+	std::array<glm::vec4, 6> planes;
+
 	frustum(glm::mat4 const & view_projection);
 };
@@ -0,0 +1,251 @@
+#include "frustum_culling.hpp"
+#include "intersect.hpp"
+
+#include <cassert>
+#include <cmath>
+#include <bit>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FRUSTUM_CULLING_SSE
+#include <immintrin.h>
+#endif
+
+void instance_bounds::reserve(std::size_t size)
+{
+	for (auto * v : {&center_x, &center_y, &center_z, &extent_x, &extent_y, &extent_z})
+		v->reserve(size);
+}
+
+void instance_bounds::clear()
+{
+	for (auto * v : {&center_x, &center_y, &center_z, &extent_x, &extent_y, &extent_z})
+		v->clear();
+}
+
+void instance_bounds::push_back(glm::vec3 const & min, glm::vec3 const & max)
+{
+	glm::vec3 const center = (min + max) * 0.5f;
+	glm::vec3 const extent = (max - min) * 0.5f;
+
+	center_x.push_back(center.x);
+	center_y.push_back(center.y);
+	center_z.push_back(center.z);
+	extent_x.push_back(extent.x);
+	extent_y.push_back(extent.y);
+	extent_z.push_back(extent.z);
+}
+
+void instance_bounds::set(std::size_t index, glm::vec3 const & min, glm::vec3 const & max)
+{
+	glm::vec3 const center = (min + max) * 0.5f;
+	glm::vec3 const extent = (max - min) * 0.5f;
+
+	center_x[index] = center.x;
+	center_y[index] = center.y;
+	center_z[index] = center.z;
+	extent_x[index] = extent.x;
+	extent_y[index] = extent.y;
+	extent_z[index] = extent.z;
+}
+
+glm::vec3 instance_bounds::min(std::size_t index) const
+{
+	return {center_x[index] - extent_x[index], center_y[index] - extent_y[index], center_z[index] - extent_z[index]};
+}
+
+glm::vec3 instance_bounds::max(std::size_t index) const
+{
+	return {center_x[index] + extent_x[index], center_y[index] + extent_y[index], center_z[index] + extent_z[index]};
+}
+
+namespace
+{
+
+	// How far the box reaches past each plane: the signed distance of the center,
+	// and the radius of the box projected onto the plane normal
+	struct plane_distances
+	{
+		float center;
+		float radius;
+	};
+
+	plane_distances distances(glm::vec4 const & plane, instance_bounds const & bounds, std::size_t i)
+	{
+		return {
+			plane.x * bounds.center_x[i] + plane.y * bounds.center_y[i] + plane.z * bounds.center_z[i] + plane.w,
+			std::abs(plane.x) * bounds.extent_x[i] + std::abs(plane.y) * bounds.extent_y[i] + std::abs(plane.z) * bounds.extent_z[i],
+		};
+	}
+
+	bool outside(frustum const & f, instance_bounds const & bounds, std::size_t i)
+	{
+		for (auto const & plane : f.planes)
+		{
+			auto const d = distances(plane, bounds, i);
+			if (d.center + d.radius < 0.f)
+				return true;
+		}
+		return false;
+	}
+
+	bool inside(frustum const & f, instance_bounds const & bounds, std::size_t i)
+	{
+		for (auto const & plane : f.planes)
+		{
+			auto const d = distances(plane, bounds, i);
+			if (d.center - d.radius < 0.f)
+				return false;
+		}
+		return true;
+	}
+
+	std::size_t cull_planes_scalar(frustum const & f, instance_bounds const & bounds, std::size_t begin, std::size_t end, std::uint32_t * visible)
+	{
+		std::size_t count = 0;
+		for (std::size_t i = begin; i < end; ++i)
+		{
+			if (!outside(f, bounds, i))
+				visible[count++] = i;
+		}
+		return count;
+	}
+
+#ifdef FRUSTUM_CULLING_SSE
+
+#ifdef __AVX__
+
+	constexpr std::size_t lane_count = 8;
+
+	struct lanes
+	{
+		__m256 value;
+
+		static lanes load(float const * p) { return {_mm256_loadu_ps(p)}; }
+		static lanes broadcast(float x) { return {_mm256_set1_ps(x)}; }
+		static lanes zero() { return {_mm256_setzero_ps()}; }
+
+		friend lanes operator + (lanes a, lanes b) { return {_mm256_add_ps(a.value, b.value)}; }
+		friend lanes operator * (lanes a, lanes b) { return {_mm256_mul_ps(a.value, b.value)}; }
+		friend lanes operator | (lanes a, lanes b) { return {_mm256_or_ps(a.value, b.value)}; }
+		friend lanes operator < (lanes a, lanes b) { return {_mm256_cmp_ps(a.value, b.value, _CMP_LT_OQ)}; }
+
+		unsigned mask() const { return _mm256_movemask_ps(value); }
+	};
+
+#else
+
+	constexpr std::size_t lane_count = 4;
+
+	struct lanes
+	{
+		__m128 value;
+
+		static lanes load(float const * p) { return {_mm_loadu_ps(p)}; }
+		static lanes broadcast(float x) { return {_mm_set1_ps(x)}; }
+		static lanes zero() { return {_mm_setzero_ps()}; }
+
+		friend lanes operator + (lanes a, lanes b) { return {_mm_add_ps(a.value, b.value)}; }
+		friend lanes operator * (lanes a, lanes b) { return {_mm_mul_ps(a.value, b.value)}; }
+		friend lanes operator | (lanes a, lanes b) { return {_mm_or_ps(a.value, b.value)}; }
+		friend lanes operator < (lanes a, lanes b) { return {_mm_cmplt_ps(a.value, b.value)}; }
+
+		unsigned mask() const { return _mm_movemask_ps(value); }
+	};
+
+#endif
+
+	constexpr std::size_t block_size = 16;
+
+	std::size_t cull_planes_simd(frustum const & f, instance_bounds const & bounds, std::size_t begin, std::size_t end, std::uint32_t * visible)
+	{
+		// The same arithmetic as distances(), in the same order, so that the result
+		// is identical to the scalar one
+		struct plane_lanes
+		{
+			lanes x, y, z, w;
+			lanes abs_x, abs_y, abs_z;
+		};
+
+		plane_lanes planes[6];
+		for (int p = 0; p < 6; ++p)
+		{
+			auto const & plane = f.planes[p];
+			planes[p] = {
+				lanes::broadcast(plane.x), lanes::broadcast(plane.y), lanes::broadcast(plane.z), lanes::broadcast(plane.w),
+				lanes::broadcast(std::abs(plane.x)), lanes::broadcast(std::abs(plane.y)), lanes::broadcast(std::abs(plane.z)),
+			};
+		}
+
+		lanes const zero = lanes::zero();
+
+		std::size_t count = 0;
+		std::size_t i = begin;
+		for (; i + block_size <= end; i += block_size)
+		{
+			// One bit per box of the block that is entirely behind some plane
+			std::uint32_t outside = 0;
+
+			for (std::size_t j = 0; j < block_size; j += lane_count)
+			{
+				lanes const cx = lanes::load(bounds.center_x.data() + i + j);
+				lanes const cy = lanes::load(bounds.center_y.data() + i + j);
+				lanes const cz = lanes::load(bounds.center_z.data() + i + j);
+				lanes const ex = lanes::load(bounds.extent_x.data() + i + j);
+				lanes const ey = lanes::load(bounds.extent_y.data() + i + j);
+				lanes const ez = lanes::load(bounds.extent_z.data() + i + j);
+
+				lanes result = zero < zero;
+				for (auto const & plane : planes)
+				{
+					lanes const center = plane.x * cx + plane.y * cy + plane.z * cz + plane.w;
+					lanes const radius = plane.abs_x * ex + plane.abs_y * ey + plane.abs_z * ez;
+					result = result | ((center + radius) < zero);
+				}
+
+				outside |= result.mask() << j;
+			}
+
+			for (std::uint32_t inside = ~outside & ((1u << block_size) - 1); inside != 0; inside &= inside - 1)
+				visible[count++] = i + std::countr_zero(inside);
+		}
+
+		return count + cull_planes_scalar(f, bounds, i, end, visible + count);
+	}
+
+#endif
+
+}
+
+std::size_t cull_planes(frustum const & f, instance_bounds const & bounds, std::span<std::uint32_t> visible)
+{
+	assert(visible.size() >= bounds.size());
+
+#ifdef FRUSTUM_CULLING_SSE
+	return cull_planes_simd(f, bounds, 0, bounds.size(), visible.data());
+#else
+	return cull_planes_scalar(f, bounds, 0, bounds.size(), visible.data());
+#endif
+}
+
+std::size_t cull_planes_scalar(frustum const & f, instance_bounds const & bounds, std::span<std::uint32_t> visible)
+{
+	assert(visible.size() >= bounds.size());
+
+	return cull_planes_scalar(f, bounds, 0, bounds.size(), visible.data());
+}
+
+std::size_t cull_exact(frustum const & f, instance_bounds const & bounds, std::span<std::uint32_t> visible)
+{
+	std::size_t const candidates = cull_planes(f, bounds, visible);
+
+	// Boxes entirely inside all the planes certainly intersect the frustum;
+	// the ones that straddle a plane may still be outside near an edge or a corner
+	std::size_t count = 0;
+	for (std::size_t c = 0; c < candidates; ++c)
+	{
+		std::uint32_t const i = visible[c];
+		if (inside(f, bounds, i) || intersect(f, bounds.box(i)))
+			visible[count++] = i;
+	}
+	return count;
+}
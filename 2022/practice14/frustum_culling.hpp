@@ -0,0 +1,47 @@
+#pragma once
+
+#include "aabb.hpp"
+#include "frustum.hpp"
+
+#include <glm/vec3.hpp>
+
+#include <vector>
+#include <span>
+#include <cstdint>
+#include <cstddef>
+
+// Bounding boxes of many instances as center/extent arrays, so that
+// the culling kernels read them several boxes at a time
+struct instance_bounds
+{
+	std::vector<float> center_x, center_y, center_z;
+	// Half the size of the box along every axis
+	std::vector<float> extent_x, extent_y, extent_z;
+
+	std::size_t size() const { return center_x.size(); }
+
+	void reserve(std::size_t size);
+	void clear();
+	void push_back(glm::vec3 const & min, glm::vec3 const & max);
+	void set(std::size_t index, glm::vec3 const & min, glm::vec3 const & max);
+
+	glm::vec3 min(std::size_t index) const;
+	glm::vec3 max(std::size_t index) const;
+	aabb box(std::size_t index) const { return aabb(min(index), max(index)); }
+};
+
+// All culling functions write the indices of the visible boxes, in increasing order,
+// into `visible` (which must have room for bounds.size() of them) and return their count.
+
+// Tests every box against the six planes of the frustum, 16 boxes per iteration with
+// AVX (when compiled with it) or SSE. Conservative: a box is only dropped when it lies
+// entirely behind one of the planes, so some boxes outside the frustum near its edges
+// and corners are kept. That is what a renderer wants: they cost a draw, not a pixel.
+std::size_t cull_planes(frustum const & f, instance_bounds const & bounds, std::span<std::uint32_t> visible);
+
+// The same one box at a time, as a reference
+std::size_t cull_planes_scalar(frustum const & f, instance_bounds const & bounds, std::span<std::uint32_t> visible);
+
+// Exact, like testing every box with the separating axis intersect() of intersect.hpp,
+// but only the boxes that straddle a plane are actually tested that way
+std::size_t cull_exact(frustum const & f, instance_bounds const & bounds, std::span<std::uint32_t> visible);
@@ -1,10 +1,10 @@
 #include "gltf_loader.hpp"
 
-#include <rapidjson/document.h>
-#include <rapidjson/istreamwrapper.h>
+#include "json_document.hpp"
 
-#include <fstream>
 #include <stdexcept>
+#include <cstring>
+#include <cstdint>
 
 static unsigned int attribute_type_to_size(std::string const & type)
 {
@@ -15,52 +15,149 @@ static unsigned int attribute_type_to_size(std::string const & type)
     return 0;
 }
 
-gltf_model load_gltf(std::filesystem::path const & path)
+static unsigned int component_type_to_size(unsigned int type)
+{
+    switch (type)
+    {
+    case 0x1400: case 0x1401: return 1; // GL_BYTE, GL_UNSIGNED_BYTE
+    case 0x1402: case 0x1403: return 2; // GL_SHORT, GL_UNSIGNED_SHORT
+    case 0x1405: case 0x1406: return 4; // GL_UNSIGNED_INT, GL_FLOAT
+    }
+    return 0;
+}
+
+struct glb_chunks
+{
+    std::span<char const> json;
+    std::span<char const> bin;
+};
+
+// See https://registry.khronos.org/glTF/specs/2.0/glTF-2.0.html#binary-gltf-layout
+static glb_chunks parse_glb(std::span<char const> data, std::filesystem::path const & path)
 {
-    rapidjson::Document document;
+    constexpr std::uint32_t glb_magic = 0x46546C67; // "glTF"
+    constexpr std::uint32_t json_chunk_type = 0x4E4F534A; // "JSON"
+    constexpr std::uint32_t bin_chunk_type = 0x004E4942; // "BIN\0"
 
+    auto read_u32 = [&](std::size_t offset)
     {
-        std::ifstream input(path, std::ios::binary);
-        rapidjson::IStreamWrapper stream(input);
-        document.ParseStream(stream);
+        std::uint32_t value;
+        std::memcpy(&value, data.data() + offset, sizeof(value));
+        return value;
+    };
+
+    if (data.size() < 12 || read_u32(0) != glb_magic)
+        throw std::runtime_error("Not a binary glTF file: " + path.string());
+    if (read_u32(4) != 2)
+        throw std::runtime_error("Unsupported binary glTF version in " + path.string());
+
+    std::size_t const length = std::min<std::size_t>(read_u32(8), data.size());
+
+    glb_chunks result;
+
+    for (std::size_t offset = 12; offset + 8 <= length;)
+    {
+        std::size_t const chunk_length = read_u32(offset);
+        std::uint32_t const chunk_type = read_u32(offset + 4);
+        offset += 8;
+
+        if (chunk_length > length - offset)
+            throw std::runtime_error("Truncated chunk in " + path.string());
+
+        auto const chunk = data.subspan(offset, chunk_length);
+        if (chunk_type == json_chunk_type && result.json.empty())
+            result.json = chunk;
+        else if (chunk_type == bin_chunk_type && result.bin.empty())
+            result.bin = chunk;
+
+        offset += chunk_length;
     }
 
+    if (result.json.empty())
+        throw std::runtime_error("No JSON chunk in " + path.string());
+
+    return result;
+}
+
+gltf_model load_gltf(std::filesystem::path const & path)
+{
     gltf_model result;
 
+    std::optional<json_document> document_storage;
+    std::span<char const> glb_bin;
+
+    if (path.extension() == ".glb")
     {
-        auto buffers = document["buffers"].GetArray();
-        assert(buffers.Size() == 1);
+        // A single mapping for both chunks; the JSON is copied once since the mapping is read-only
+        result.file = mapped_file(path, mapped_file::access::random);
+        auto const chunks = parse_glb({result.file.data(), result.file.size()}, path);
 
-        auto const buffer_uri = buffers[0]["uri"].GetString();
+        document_storage.emplace(chunks.json, path.string());
+        glb_bin = chunks.bin;
+    }
+    else
+        document_storage.emplace(path);
 
-        auto const buffer_path = path.parent_path() / buffer_uri;
+    auto const & document = *document_storage;
 
-        result.buffer.resize(std::filesystem::file_size(buffer_path));
-        std::ifstream buffer(buffer_path, std::ios::binary);
-        buffer.read(result.buffer.data(), result.buffer.size());
+    {
+        auto buffers = document["buffers"].GetArray();
+        assert(buffers.Size() == 1);
+
+        if (buffers[0].HasMember("uri"))
+        {
+            result.file = mapped_file(path.parent_path() / buffers[0]["uri"].GetString(), mapped_file::access::random);
+            result.buffer = {result.file.data(), result.file.size()};
+        }
+        else if (!glb_bin.empty())
+            result.buffer = glb_bin;
+        else
+            throw std::runtime_error("No binary buffer in " + path.string());
     }
 
-    auto parse_buffer_view = [&](int index) -> gltf_model::buffer_view
+    // Buffer views and accessors are resolved once into flat tables indexed like the JSON arrays
+
+    std::vector<gltf_model::buffer_view> buffer_views;
+    // Bytes between elements, 0 when they are packed
+    std::vector<unsigned int> buffer_view_strides;
+    for (auto const & view : document["bufferViews"].GetArray())
     {
-        auto view = document["bufferViews"].GetArray()[index].GetObject();
-        return {view["byteOffset"].GetUint(), view["byteLength"].GetUint()};
-    };
+        buffer_views.push_back({view.HasMember("byteOffset") ? view["byteOffset"].GetUint() : 0u, view["byteLength"].GetUint()});
+        buffer_view_strides.push_back(view.HasMember("byteStride") ? view["byteStride"].GetUint() : 0u);
+    }
 
-    auto parse_accessor = [&](int index) -> gltf_model::accessor
+    std::vector<gltf_model::accessor> accessors;
+    for (auto const & accessor : document["accessors"].GetArray())
     {
-        auto accessor = document["accessors"].GetArray()[index].GetObject();
-        return {
-            parse_buffer_view(accessor["bufferView"].GetInt()),
+        auto const & result_accessor = accessors.emplace_back(gltf_model::accessor{
+            accessor.HasMember("bufferView") ? buffer_views.at(accessor["bufferView"].GetUint()) : gltf_model::buffer_view{0, 0},
             accessor["componentType"].GetUint(),
             attribute_type_to_size(accessor["type"].GetString()),
             accessor["count"].GetUint(),
-        };
+        });
+
+        // Attributes are drawn and read as tightly packed arrays
+        if (accessor.HasMember("bufferView"))
+        {
+            unsigned int const stride = buffer_view_strides[accessor["bufferView"].GetUint()];
+            if (stride != 0 && stride != result_accessor.size * component_type_to_size(result_accessor.type))
+                throw std::runtime_error("Interleaved vertex attributes are not supported: " + path.string());
+        }
+    }
+
+    auto parse_accessor = [&](int index) -> gltf_model::accessor const &
+    {
+        return accessors.at(index);
     };
 
-    auto parse_texture = [&](int index) -> std::string
+    // Images embedded into a buffer view (as in most .glb files) are not supported
+    auto parse_texture = [&](int index) -> std::optional<std::string>
     {
         auto const source_index = document["textures"].GetArray()[index]["source"].GetInt();
-        return document["images"].GetArray()[source_index]["uri"].GetString();
+        auto const & image = document["images"].GetArray()[source_index];
+        if (!image.HasMember("uri"))
+            return std::nullopt;
+        return image["uri"].GetString();
     };
 
     auto parse_color = [&](auto const & array)
@@ -82,15 +179,38 @@ gltf_model load_gltf(std::filesystem::path const & path)
         };
     };
 
+    auto const & accessor_values = document["accessors"];
+
     auto parse_bounds = [&](int index)
     {
-        auto accessor = document["accessors"].GetArray()[index].GetObject();
+        auto const & accessor = accessor_values[index];
         return std::make_pair(
             parse_vector(accessor["min"]),
             parse_vector(accessor["max"])
         );
     };
 
+    std::vector<gltf_model::material> materials;
+    if (document.HasMember("materials"))
+    {
+        for (auto const & material : document["materials"].GetArray())
+        {
+            auto & result_material = materials.emplace_back();
+
+            result_material.two_sided = material.HasMember("doubleSided") && material["doubleSided"].GetBool();
+            result_material.transparent = material.HasMember("alphaMode") && (material["alphaMode"].GetString() == std::string("BLEND"));
+
+            if (!material.HasMember("pbrMetallicRoughness"))
+                continue;
+
+            auto const & pbr = material["pbrMetallicRoughness"];
+            if (pbr.HasMember("baseColorTexture"))
+                result_material.texture_path = parse_texture(pbr["baseColorTexture"]["index"].GetInt());
+            if (!result_material.texture_path && pbr.HasMember("baseColorFactor"))
+                result_material.color = parse_color(pbr["baseColorFactor"].GetArray());
+        }
+    }
+
     for (auto const & mesh : document["meshes"].GetArray())
     {
         auto & result_mesh = result.meshes.emplace_back();
@@ -108,16 +228,8 @@ gltf_model load_gltf(std::filesystem::path const & path)
 
         std::tie(result_mesh.min, result_mesh.max) = parse_bounds(attributes["POSITION"].GetInt());
 
-        auto const & material = document["materials"].GetArray()[primitives[0]["material"].GetInt()];
-
-        result_mesh.material.two_sided = material.HasMember("doubleSided") && material["doubleSided"].GetBool();
-        result_mesh.material.transparent = material.HasMember("alphaMode") && (material["alphaMode"].GetString() == std::string("BLEND"));
-
-        auto const & pbr = material["pbrMetallicRoughness"];
-        if (pbr.HasMember("baseColorTexture"))
-            result_mesh.material.texture_path = parse_texture(pbr["baseColorTexture"]["index"].GetInt());
-        else if (pbr.HasMember("baseColorFactor"))
-            result_mesh.material.color = parse_color(pbr["baseColorFactor"].GetArray());
+        if (primitives[0].HasMember("material"))
+            result_mesh.material = materials.at(primitives[0]["material"].GetUint());
     }
 
     return result;
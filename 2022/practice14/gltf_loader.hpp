@@ -2,6 +2,8 @@
 
 #include <filesystem>
 #include <vector>
+#include <span>
+#include <cassert>
 #include <string>
 #include <optional>
 #include <unordered_map>
@@ -12,6 +14,8 @@
 #include <glm/gtx/quaternion.hpp>
 #include <glm/gtx/compatibility.hpp>
 
+#include "mapped_file.hpp"
+
 struct gltf_model
 {
     struct buffer_view
@@ -51,8 +55,21 @@ struct gltf_model
         glm::vec3 max;
     };
 
-    std::vector<char> buffer;
+    // The mapped .bin file, or the whole .glb container, kept for the lifetime of the model
+    mapped_file file;
+    // The binary buffer within it; upload it with glBufferData(buffer.data(), buffer.size())
+    // and read it through accessor_data
+    std::span<char const> buffer;
     std::vector<mesh> meshes;
+
+    template <typename T>
+    std::span<T const> accessor_data(accessor const & accessor) const
+    {
+        assert(accessor.view.offset + accessor.count * sizeof(T) <= buffer.size());
+        return {reinterpret_cast<T const *>(buffer.data() + accessor.view.offset), accessor.count};
+    }
 };
 
+// Loads a .gltf file with a single external buffer, or a binary .glb container.
+// Vertex attributes must be tightly packed, files with interleaved ones are rejected.
 gltf_model load_gltf(std::filesystem::path const & path);
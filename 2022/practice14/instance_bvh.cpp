@@ -0,0 +1,346 @@
+#include "instance_bvh.hpp"
+
+#include <glm/common.hpp>
+
+#include <algorithm>
+#include <stdexcept>
+#include <limits>
+#include <cassert>
+#include <cmath>
+#include <bit>
+
+namespace
+{
+
+	constexpr std::size_t bin_count = 16;
+	// Nodes with this many instances or fewer are always leaves
+	constexpr std::uint32_t min_leaf_size = 4;
+	// Larger nodes are always split, even when SAH prefers a leaf
+	constexpr std::uint32_t max_leaf_size = 16;
+	// Deep enough for any sane scene; below this the splits are median ones, which bound the depth
+	constexpr std::size_t max_sah_depth = 48;
+	constexpr std::size_t max_depth = 64;
+
+	struct box
+	{
+		glm::vec3 min{std::numeric_limits<float>::infinity()};
+		glm::vec3 max{-std::numeric_limits<float>::infinity()};
+
+		void extend(glm::vec3 const & p_min, glm::vec3 const & p_max)
+		{
+			min = glm::min(min, p_min);
+			max = glm::max(max, p_max);
+		}
+
+		void extend(box const & other)
+		{
+			extend(other.min, other.max);
+		}
+
+		float half_area() const
+		{
+			glm::vec3 const size = max - min;
+			return (size.x >= 0.f) ? size.x * size.y + size.y * size.z + size.z * size.x : 0.f;
+		}
+	};
+
+	box instance_box(instance_bounds const & bounds, std::uint32_t i)
+	{
+		return {bounds.min(i), bounds.max(i)};
+	}
+
+	glm::vec3 centroid(instance_bounds const & bounds, std::uint32_t i)
+	{
+		return {bounds.center_x[i], bounds.center_y[i], bounds.center_z[i]};
+	}
+
+}
+
+instance_bvh::instance_bvh(instance_bounds const & bounds)
+{
+	build(bounds);
+}
+
+void instance_bvh::build(instance_bounds const & bounds)
+{
+	if (bounds.size() >= std::numeric_limits<std::uint32_t>::max())
+		throw std::runtime_error("Too many instances for a BVH: " + std::to_string(bounds.size()));
+
+	std::uint32_t const instance_count = bounds.size();
+
+	indices_.resize(instance_count);
+	for (std::uint32_t i = 0; i < instance_count; ++i)
+		indices_[i] = i;
+
+	nodes_.clear();
+	nodes_.reserve(instance_count > 0 ? 2 * ((instance_count + min_leaf_size - 1) / min_leaf_size) : 1);
+	nodes_.push_back({glm::vec3(0.f), glm::vec3(0.f), 0, instance_count, 0});
+	depth_ = 1;
+
+	struct task
+	{
+		std::uint32_t node;
+		std::size_t depth;
+	};
+
+	std::vector<task> stack{{0, 1}};
+
+	while (!stack.empty())
+	{
+		auto const [node_index, depth] = stack.back();
+		stack.pop_back();
+		depth_ = std::max(depth_, depth);
+
+		std::uint32_t const first = nodes_[node_index].first;
+		std::uint32_t const count = nodes_[node_index].count;
+
+		box bounds_box, centroid_box;
+		for (std::uint32_t k = first; k < first + count; ++k)
+		{
+			bounds_box.extend(instance_box(bounds, indices_[k]));
+			glm::vec3 const c = centroid(bounds, indices_[k]);
+			centroid_box.extend(c, c);
+		}
+
+		nodes_[node_index].min = bounds_box.min;
+		nodes_[node_index].max = bounds_box.max;
+
+		if (count <= min_leaf_size || depth == max_depth)
+			continue;
+
+		// The split: instances whose centroid bin along `axis` is below `split_bin` go left
+		int best_axis = -1;
+		std::size_t best_bin = 0;
+		float best_cost = std::numeric_limits<float>::infinity();
+
+		glm::vec3 const centroid_size = centroid_box.max - centroid_box.min;
+
+		auto bin_of = [&](glm::vec3 const & c, int axis)
+		{
+			float const t = (c[axis] - centroid_box.min[axis]) / centroid_size[axis];
+			return std::min<std::size_t>(bin_count - 1, static_cast<std::size_t>(t * bin_count));
+		};
+
+		if (depth < max_sah_depth)
+		{
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				if (!(centroid_size[axis] > 0.f))
+					continue;
+
+				box bin_boxes[bin_count];
+				std::uint32_t bin_counts[bin_count] = {};
+
+				for (std::uint32_t k = first; k < first + count; ++k)
+				{
+					std::size_t const bin = bin_of(centroid(bounds, indices_[k]), axis);
+					bin_boxes[bin].extend(instance_box(bounds, indices_[k]));
+					++bin_counts[bin];
+				}
+
+				// Cost of splitting before every bin: areas times counts on both sides
+				float left_costs[bin_count];
+				box left;
+				std::uint32_t left_count = 0;
+				for (std::size_t b = 1; b < bin_count; ++b)
+				{
+					left.extend(bin_boxes[b - 1]);
+					left_count += bin_counts[b - 1];
+					left_costs[b] = left.half_area() * left_count;
+				}
+
+				box right;
+				std::uint32_t right_count = 0;
+				for (std::size_t b = bin_count - 1; b > 0; --b)
+				{
+					right.extend(bin_boxes[b]);
+					right_count += bin_counts[b];
+
+					float const cost = left_costs[b] + right.half_area() * right_count;
+					if (right_count > 0 && right_count < count && cost < best_cost)
+					{
+						best_cost = cost;
+						best_axis = axis;
+						best_bin = b;
+					}
+				}
+			}
+		}
+
+		std::uint32_t middle;
+
+		if (best_axis >= 0)
+		{
+			// A leaf costs testing all its instances; a split, testing the children
+			// (relative to the parent's area) and then their instances
+			float const leaf_cost = bounds_box.half_area() * count;
+			if (count <= max_leaf_size && best_cost >= leaf_cost)
+				continue;
+
+			middle = std::partition(indices_.begin() + first, indices_.begin() + first + count, [&](std::uint32_t i)
+			{
+				return bin_of(centroid(bounds, i), best_axis) < best_bin;
+			}) - indices_.begin();
+		}
+		else
+		{
+			// All centroids in one place, or too deep: split in the middle of the widest axis
+			int const axis = (centroid_size.x >= centroid_size.y && centroid_size.x >= centroid_size.z) ? 0
+				: (centroid_size.y >= centroid_size.z ? 1 : 2);
+			middle = first + count / 2;
+			std::nth_element(indices_.begin() + first, indices_.begin() + middle, indices_.begin() + first + count,
+				[&](std::uint32_t i, std::uint32_t j){ return centroid(bounds, i)[axis] < centroid(bounds, j)[axis]; });
+		}
+
+		std::uint32_t const child = nodes_.size();
+		nodes_[node_index].child = child;
+		nodes_.push_back({glm::vec3(0.f), glm::vec3(0.f), first, middle - first, 0});
+		nodes_.push_back({glm::vec3(0.f), glm::vec3(0.f), middle, first + count - middle, 0});
+
+		stack.push_back({child + 1, depth + 1});
+		stack.push_back({child, depth + 1});
+	}
+}
+
+void instance_bvh::refit(instance_bounds const & bounds)
+{
+	assert(bounds.size() == indices_.size());
+
+	// Children always come after their parents
+	for (std::size_t n = nodes_.size(); n-- > 0;)
+	{
+		auto & node = nodes_[n];
+
+		box result;
+		if (node.child == 0)
+		{
+			for (std::uint32_t k = node.first; k < node.first + node.count; ++k)
+				result.extend(instance_box(bounds, indices_[k]));
+		}
+		else
+		{
+			result.extend(nodes_[node.child].min, nodes_[node.child].max);
+			result.extend(nodes_[node.child + 1].min, nodes_[node.child + 1].max);
+		}
+
+		node.min = result.min;
+		node.max = result.max;
+	}
+}
+
+std::size_t instance_bvh::cull(frustum const & f, instance_bounds const & bounds, std::span<std::uint32_t> visible) const
+{
+	if (indices_.empty())
+		return 0;
+
+	return cull(f, bounds, 0, visible);
+}
+
+std::size_t instance_bvh::cull(frustum const & f, instance_bounds const & bounds, std::uint32_t root, std::span<std::uint32_t> visible) const
+{
+	assert(visible.size() >= nodes_[root].count);
+
+	constexpr unsigned all_planes = (1u << 6) - 1;
+
+	struct entry
+	{
+		std::uint32_t node;
+		// Planes the node is not yet known to be entirely inside of
+		unsigned planes;
+	};
+
+	entry stack[max_depth + 1];
+	std::size_t stack_size = 0;
+	stack[stack_size++] = {root, all_planes};
+
+	std::size_t count = 0;
+
+	while (stack_size > 0)
+	{
+		auto const [node_index, node_planes] = stack[--stack_size];
+		auto const & node = nodes_[node_index];
+
+		glm::vec3 const center = (node.min + node.max) * 0.5f;
+		glm::vec3 const extent = (node.max - node.min) * 0.5f;
+
+		unsigned planes = node_planes;
+		bool outside = false;
+		for (unsigned remaining = node_planes; remaining != 0; remaining &= remaining - 1)
+		{
+			int const p = std::countr_zero(remaining);
+			auto const & plane = f.planes[p];
+
+			float const distance = plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w;
+			float const radius = std::abs(plane.x) * extent.x + std::abs(plane.y) * extent.y + std::abs(plane.z) * extent.z;
+
+			if (distance + radius < 0.f)
+			{
+				outside = true;
+				break;
+			}
+			if (distance - radius >= 0.f)
+				planes &= ~(1u << p);
+		}
+
+		if (outside)
+			continue;
+
+		if (planes == 0)
+		{
+			std::copy_n(indices_.begin() + node.first, node.count, visible.begin() + count);
+			count += node.count;
+		}
+		else if (node.child == 0)
+		{
+			// The leaf straddles some planes: test its instances against just those
+			for (std::uint32_t k = node.first; k < node.first + node.count; ++k)
+			{
+				std::uint32_t const i = indices_[k];
+				bool instance_outside = false;
+				for (unsigned remaining = planes; remaining != 0 && !instance_outside; remaining &= remaining - 1)
+				{
+					auto const & plane = f.planes[std::countr_zero(remaining)];
+					float const distance = plane.x * bounds.center_x[i] + plane.y * bounds.center_y[i] + plane.z * bounds.center_z[i] + plane.w;
+					float const radius = std::abs(plane.x) * bounds.extent_x[i] + std::abs(plane.y) * bounds.extent_y[i] + std::abs(plane.z) * bounds.extent_z[i];
+					instance_outside = (distance + radius < 0.f);
+				}
+				if (!instance_outside)
+					visible[count++] = i;
+			}
+		}
+		else
+		{
+			assert(stack_size + 2 <= max_depth + 1);
+			stack[stack_size++] = {node.child + 1, planes};
+			stack[stack_size++] = {node.child, planes};
+		}
+	}
+
+	return count;
+}
+
+std::vector<std::uint32_t> instance_bvh::subtrees(std::size_t count) const
+{
+	std::vector<std::uint32_t> result;
+	if (nodes_.empty() || indices_.empty())
+		return result;
+
+	result.push_back(0);
+	while (result.size() < count)
+	{
+		auto largest = std::max_element(result.begin(), result.end(), [&](std::uint32_t a, std::uint32_t b)
+		{
+			// Leaves can't be split, so they are never the largest
+			return (nodes_[a].child == 0 ? 0 : nodes_[a].count) < (nodes_[b].child == 0 ? 0 : nodes_[b].count);
+		});
+
+		if (nodes_[*largest].child == 0)
+			break;
+
+		std::uint32_t const child = nodes_[*largest].child;
+		*largest = child;
+		result.push_back(child + 1);
+	}
+
+	return result;
+}
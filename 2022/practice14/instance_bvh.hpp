@@ -0,0 +1,63 @@
+#pragma once
+
+#include "frustum.hpp"
+#include "frustum_culling.hpp"
+
+#include <glm/vec3.hpp>
+
+#include <vector>
+#include <span>
+#include <cstdint>
+#include <cstddef>
+
+// A bounding volume hierarchy over instance bounds, built with binned SAH. Culling
+// walks it from the root and drops whole subtrees behind a frustum plane, and takes
+// whole subtrees inside all planes without looking at their boxes, so its cost
+// depends on how many instances are near the frustum rather than on how many there are.
+// The instances of every subtree are a contiguous range of indices().
+struct instance_bvh
+{
+	instance_bvh() = default;
+	explicit instance_bvh(instance_bounds const & bounds);
+
+	void build(instance_bounds const & bounds);
+
+	// Recomputes the node bounds after instances moved, keeping the tree.
+	// Much cheaper than build(), but the tree gets worse as instances wander
+	// away from where it was built for; rebuild now and then.
+	void refit(instance_bounds const & bounds);
+
+	// The same boxes as cull_planes() keeps, though not in increasing order.
+	// `bounds` must be the ones the tree was built or refit for.
+	std::size_t cull(frustum const & f, instance_bounds const & bounds, std::span<std::uint32_t> visible) const;
+
+	// The same for the subtree of one node; `visible` needs room for its instances
+	std::size_t cull(frustum const & f, instance_bounds const & bounds, std::uint32_t root, std::span<std::uint32_t> visible) const;
+
+	// Roots of disjoint subtrees that together hold all instances, at least `count`
+	// of them unless the tree has fewer leaves, for culling the subtrees in parallel.
+	// The largest subtrees are split first, so they are of similar sizes.
+	std::vector<std::uint32_t> subtrees(std::size_t count) const;
+
+	std::size_t node_count() const { return nodes_.size(); }
+	std::size_t depth() const { return depth_; }
+	std::span<std::uint32_t const> indices() const { return indices_; }
+
+	struct node
+	{
+		glm::vec3 min;
+		glm::vec3 max;
+		// The instances of the subtree: indices()[first, first + count)
+		std::uint32_t first;
+		std::uint32_t count;
+		// The children are nodes child and child + 1; 0 for leaves
+		std::uint32_t child;
+	};
+
+	std::span<node const> nodes() const { return nodes_; }
+
+private:
+	std::vector<node> nodes_;
+	std::vector<std::uint32_t> indices_;
+	std::size_t depth_ = 0;
+};
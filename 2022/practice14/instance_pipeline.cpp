@@ -0,0 +1,112 @@
+#include "instance_pipeline.hpp"
+
+#include <glm/geometric.hpp>
+#include <glm/common.hpp>
+
+#include <algorithm>
+#include <stdexcept>
+#include <cassert>
+
+instance_pipeline::instance_pipeline(instance_bvh const & bvh, instance_bounds const & bounds, std::span<glm::vec3 const> offsets,
+	lod_selector selector, std::size_t worker_count)
+	: selector(std::move(selector))
+	, bvh_(&bvh)
+	, bounds_(&bounds)
+	, offsets_(offsets)
+	// A few subtrees per worker, so that workers that got cheap ones take more
+	, subtrees_(bvh.subtrees(4 * worker_count))
+	, instance_lods_(bounds.size(), 0)
+	, slabs_(worker_count)
+	, lod_first_(this->selector.lod_count(), 0)
+	, lod_counts_(this->selector.lod_count(), 0)
+{
+	assert(offsets.size() == bounds.size());
+
+	if (lod_count() > 256)
+		throw std::runtime_error("Unsupported LOD count: " + std::to_string(lod_count()));
+
+	std::size_t largest_subtree = 0;
+	for (std::uint32_t root : subtrees_)
+		largest_subtree = std::max<std::size_t>(largest_subtree, bvh.nodes()[root].count);
+
+	// Any worker may end up with all instances
+	for (auto & slab : slabs_)
+	{
+		slab.visible.resize(largest_subtree);
+		slab.instances.resize(bounds.size());
+		slab.lods.resize(bounds.size());
+		slab.lod_counts.resize(lod_count());
+		slab.lod_cursors.resize(lod_count());
+	}
+}
+
+void instance_pipeline::update(frustum const & f, glm::vec3 const & camera_position, worker_pool & pool)
+{
+	assert(pool.size() <= slabs_.size());
+
+	for (auto & slab : slabs_)
+	{
+		slab.size = 0;
+		std::fill(slab.lod_counts.begin(), slab.lod_counts.end(), 0);
+	}
+
+	pool.parallel_for(subtrees_.size(), [&](std::size_t begin, std::size_t end, std::size_t worker)
+	{
+		auto & slab = slabs_[worker];
+
+		for (std::size_t s = begin; s < end; ++s)
+		{
+			std::size_t const count = bvh_->cull(f, *bounds_, subtrees_[s], slab.visible);
+
+			for (std::size_t v = 0; v < count; ++v)
+			{
+				std::uint32_t const i = slab.visible[v];
+
+				glm::vec3 const center{bounds_->center_x[i], bounds_->center_y[i], bounds_->center_z[i]};
+				glm::vec3 const extent{bounds_->extent_x[i], bounds_->extent_y[i], bounds_->extent_z[i]};
+				float const distance = glm::length(glm::max(glm::abs(camera_position - center) - extent, glm::vec3(0.f)));
+
+				std::size_t const lod = selector.select(distance, instance_lods_[i]);
+				instance_lods_[i] = lod;
+
+				slab.instances[slab.size] = i;
+				slab.lods[slab.size] = lod;
+				++slab.size;
+				++slab.lod_counts[lod];
+			}
+		}
+	});
+
+	// Every LOD's range of the instance buffer, and within it every slab's range
+	std::size_t first = 0;
+	for (std::size_t lod = 0; lod < lod_count(); ++lod)
+	{
+		lod_first_[lod] = first;
+		for (auto & slab : slabs_)
+		{
+			slab.lod_cursors[lod] = first;
+			first += slab.lod_counts[lod];
+		}
+		lod_counts_[lod] = first - lod_first_[lod];
+	}
+	visible_count_ = first;
+
+	triangle_count_ = 0;
+	for (std::size_t lod = 0; lod < lod_count(); ++lod)
+		triangle_count_ += lod_counts_[lod] * selector[lod].triangle_count;
+}
+
+void instance_pipeline::write(std::span<glm::vec3> destination, worker_pool & pool)
+{
+	assert(destination.size() >= visible_count_);
+
+	pool.parallel_for(slabs_.size(), [&](std::size_t begin, std::size_t end, std::size_t)
+	{
+		for (std::size_t w = begin; w < end; ++w)
+		{
+			auto & slab = slabs_[w];
+			for (std::size_t k = 0; k < slab.size; ++k)
+				destination[slab.lod_cursors[slab.lods[k]]++] = offsets_[slab.instances[k]];
+		}
+	});
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "frustum.hpp"
+#include "frustum_culling.hpp"
+#include "instance_bvh.hpp"
+#include "lod_selector.hpp"
+#include "worker_pool.hpp"
+
+#include <glm/vec3.hpp>
+
+#include <vector>
+#include <span>
+#include <cstdint>
+#include <cstddef>
+
+// The per-frame instance work of practice14 as two parallel passes:
+//  - update(): every worker culls some subtrees of the BVH and picks a LOD for each
+//    visible instance, appending them to its own slab, so no worker waits for another;
+//    the LOD an instance had is kept for the selector's hysteresis, and since every
+//    instance is in exactly one subtree, only one worker touches it;
+//  - write(): every worker copies the offsets of its slab's instances into the
+//    instance buffer, where the instances of each LOD are contiguous.
+// The slabs are sized for the worst case in the constructor, so that no frame allocates.
+// The tree, bounds and offsets are referenced, not copied, and must outlive the pipeline.
+struct instance_pipeline
+{
+	instance_pipeline(instance_bvh const & bvh, instance_bounds const & bounds, std::span<glm::vec3 const> offsets,
+		lod_selector selector, std::size_t worker_count);
+
+	std::size_t lod_count() const { return lod_first_.size(); }
+
+	// Instances are measured from the camera to the nearest point of their bounds;
+	// set the pixel budget and the viewport here
+	lod_selector selector;
+
+	// `worker_count` must not be less than pool.size()
+	void update(frustum const & f, glm::vec3 const & camera_position, worker_pool & pool);
+
+	// After update(): all visible instances, and those of each LOD
+	std::size_t visible_count() const { return visible_count_; }
+	std::size_t lod_first(std::size_t lod) const { return lod_first_[lod]; }
+	std::size_t lod_instance_count(std::size_t lod) const { return lod_counts_[lod]; }
+	// The triangles the draws of all LODs will submit
+	std::size_t triangle_count() const { return triangle_count_; }
+
+	// Every instance's LOD as of the last frame it was visible in
+	std::span<std::uint8_t const> instance_lods() const { return instance_lods_; }
+
+	// Writes the visible offsets, LOD after LOD, once after every update();
+	// `destination` needs room for visible_count()
+	void write(std::span<glm::vec3> destination, worker_pool & pool);
+
+private:
+	instance_bvh const * bvh_;
+	instance_bounds const * bounds_;
+	std::span<glm::vec3 const> offsets_;
+	std::vector<std::uint32_t> subtrees_;
+	std::vector<std::uint8_t> instance_lods_;
+
+	struct worker_slab
+	{
+		// Culling output of the subtree being processed
+		std::vector<std::uint32_t> visible;
+		// The slab: visible instances with their LODs
+		std::vector<std::uint32_t> instances;
+		std::vector<std::uint8_t> lods;
+		std::size_t size = 0;
+		std::vector<std::size_t> lod_counts;
+		// Where the slab's instances of every LOD go in write()
+		std::vector<std::size_t> lod_cursors;
+	};
+
+	std::vector<worker_slab> slabs_;
+	std::vector<std::size_t> lod_first_;
+	std::vector<std::size_t> lod_counts_;
+	std::size_t visible_count_ = 0;
+	std::size_t triangle_count_ = 0;
+};
@@ -0,0 +1,104 @@
+#include "lod_selector.hpp"
+#include "mesh_error.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <cmath>
+
+namespace
+{
+
+	constexpr unsigned int gl_unsigned_byte = 0x1401;
+	constexpr unsigned int gl_unsigned_short = 0x1403;
+	constexpr unsigned int gl_unsigned_int = 0x1405;
+
+	template <typename Index>
+	void append_indices(gltf_model const & model, gltf_model::accessor const & accessor, std::vector<std::uint32_t> & result)
+	{
+		for (auto index : model.accessor_data<Index>(accessor))
+			result.push_back(index);
+	}
+
+	std::vector<std::uint32_t> mesh_indices(gltf_model const & model, gltf_model::mesh const & mesh)
+	{
+		std::vector<std::uint32_t> result;
+		result.reserve(mesh.indices.count);
+
+		switch (mesh.indices.type)
+		{
+		case gl_unsigned_byte: append_indices<std::uint8_t>(model, mesh.indices, result); break;
+		case gl_unsigned_short: append_indices<std::uint16_t>(model, mesh.indices, result); break;
+		case gl_unsigned_int: append_indices<std::uint32_t>(model, mesh.indices, result); break;
+		default: throw std::runtime_error("Unsupported index type in mesh " + mesh.name);
+		}
+
+		return result;
+	}
+
+}
+
+lod_selector::lod_selector(std::vector<level> levels)
+	: levels_(std::move(levels))
+{
+	if (levels_.empty())
+		throw std::runtime_error("A LOD selector needs at least one level");
+
+	// A coarser LOD that happens to measure closer than a finer one would otherwise
+	// be chosen over it
+	levels_[0].error = 0.f;
+	for (std::size_t lod = 1; lod < levels_.size(); ++lod)
+		levels_[lod].error = std::max(levels_[lod].error, levels_[lod - 1].error);
+}
+
+void lod_selector::set_viewport(float fovy, float viewport_height)
+{
+	pixels_per_unit_ = viewport_height / (2.f * std::tan(fovy / 2.f));
+}
+
+float lod_selector::screen_error(std::size_t lod, float distance) const
+{
+	return levels_[lod].error * pixels_per_unit_ / distance;
+}
+
+std::size_t lod_selector::coarsest_within(float max_error) const
+{
+	std::size_t lod = levels_.size() - 1;
+	while (lod > 0 && levels_[lod].error > max_error)
+		--lod;
+	return lod;
+}
+
+std::size_t lod_selector::select(float distance) const
+{
+	return coarsest_within(pixel_budget * distance / pixels_per_unit_);
+}
+
+std::size_t lod_selector::select(float distance, std::size_t current) const
+{
+	// Within the band the current LOD stays: it must get coarser once even a
+	// stricter budget allows it, and finer once even a looser one doesn't
+	float const units_per_pixel = distance / pixels_per_unit_;
+	std::size_t const finest = coarsest_within(pixel_budget * (1.f - hysteresis) * units_per_pixel);
+	std::size_t const coarsest = coarsest_within(pixel_budget * (1.f + hysteresis) * units_per_pixel);
+	return std::clamp(current, finest, coarsest);
+}
+
+std::vector<lod_selector::level> measure_lod_levels(gltf_model const & model)
+{
+	if (model.meshes.empty())
+		return {};
+
+	auto const & reference = model.meshes[0];
+	auto const reference_positions = model.accessor_data<glm::vec3>(reference.position);
+	auto const reference_indices = mesh_indices(model, reference);
+
+	std::vector<lod_selector::level> result;
+	for (auto const & mesh : model.meshes)
+	{
+		auto const indices = mesh_indices(model, mesh);
+		float const error = (&mesh == &reference) ? 0.f
+			: mesh_distance(model.accessor_data<glm::vec3>(mesh.position), indices, reference_positions, reference_indices);
+		result.push_back({error, indices.size() / 3});
+	}
+	return result;
+}
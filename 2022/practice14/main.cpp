@@ -29,7 +29,11 @@
 #include "stb_image.h"
 #include "aabb.hpp"
 #include "frustum.hpp"
-#include "intersect.hpp"
+#include "frustum_culling.hpp"
+#include "instance_bvh.hpp"
+#include "instance_pipeline.hpp"
+#include "lod_selector.hpp"
+#include "worker_pool.hpp"
 
 std::string to_string(std::string_view str)
 {
@@ -192,7 +196,11 @@ int main() try
     glBufferData(GL_ARRAY_BUFFER, input_model.buffer.size(), input_model.buffer.data(), GL_STATIC_DRAW);
 
 
-    std::vector<GLuint> offsets_vbos;
+    // The offsets of the visible instances of all LODs, LOD after LOD;
+    // every LOD's VAO reads its range of it
+    GLuint instances_vbo;
+    glGenBuffers(1, &instances_vbo);
+
     std::vector<GLuint> vaos;
     for (int i = 0; i < input_model.meshes.size(); ++i)
     {
@@ -213,14 +221,11 @@ int main() try
         setup_attribute(1, input_model.meshes[i].normal);
         setup_attribute(2, input_model.meshes[i].texcoord);
 
-        GLuint offsets_vbo;
-        glGenBuffers(1, &offsets_vbo);
-        glBindBuffer(GL_ARRAY_BUFFER, offsets_vbo);
+        glBindBuffer(GL_ARRAY_BUFFER, instances_vbo);
         glEnableVertexAttribArray(3);
         glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
         glVertexAttribDivisor(3, 1);
 
-        offsets_vbos.push_back(offsets_vbo);
         vaos.push_back(vao);
     }
 
@@ -244,6 +249,25 @@ int main() try
         stbi_image_free(data);
     }
 
+    // A grid of bunnies, with bounds in the layout the culling kernels read and a tree over them
+    std::vector<glm::vec3> instance_offsets;
+    instance_bounds instance_boxes;
+    {
+        int scale = 16;
+        for (int i = -scale; i < scale; i++) {
+            for (int j = -scale; j < scale; j++) {
+                glm::vec3 current_offset = {i, 0, j};
+                instance_offsets.push_back(current_offset);
+                instance_boxes.push_back(input_model.meshes[0].min + current_offset, input_model.meshes[0].max + current_offset);
+            }
+        }
+    }
+    instance_bvh instance_tree(instance_boxes);
+
+    worker_pool workers;
+    // The meshes of bunny.gltf are LODs of the first one; a LOD is drawn while its error stays under a pixel
+    instance_pipeline instances(instance_tree, instance_boxes, instance_offsets, lod_selector(measure_lod_levels(input_model)), workers.size());
+
     auto last_frame_start = std::chrono::high_resolution_clock::now();
 
     float time = 0.f;
@@ -298,6 +322,11 @@ int main() try
             button_down[event.key.keysym.sym] = true;
             if (event.key.keysym.sym == SDLK_SPACE)
                 paused = !paused;
+            // Coarser or finer LODs
+            if (event.key.keysym.sym == SDLK_EQUALS)
+                instances.selector.pixel_budget *= 2.f;
+            if (event.key.keysym.sym == SDLK_MINUS)
+                instances.selector.pixel_budget /= 2.f;
             break;
         case SDL_KEYUP:
             button_down[event.key.keysym.sym] = false;
@@ -357,7 +386,8 @@ int main() try
         view = glm::rotate(view, camera_rotation, {0.f, 1.f, 0.f});
         view = glm::translate(view, -camera_position);
 
-        glm::mat4 projection = glm::perspective(glm::pi<float>() / 2.f, (1.f * width) / height, near, far);
+        float const fovy = glm::pi<float>() / 2.f;
+        glm::mat4 projection = glm::perspective(fovy, (1.f * width) / height, near, far);
 
         glm::vec3 camera_position = (glm::inverse(view) * glm::vec4(0.f, 0.f, 0.f, 1.f)).xyz();
 
@@ -365,34 +395,27 @@ int main() try
 
         frustum frustum_object = frustum(projection * view);
 
-//        glBindBuffer(GL_ARRAY_BUFFER, offsets_vbo);
-        std::vector<glm::vec3> frustum_offsets;
-        int scale = 16;
-        for (int i = -scale; i < scale; i++) {
-            for (int j = -scale; j < scale; j++) {
-                glm::vec3 current_offset = {i, 0, j};
-                aabb current_aabb = aabb(input_model.meshes[0].min + current_offset, input_model.meshes[0].max + current_offset);
-                if (intersect(frustum_object, current_aabb))
-                    frustum_offsets.push_back(current_offset);
-            }
-        }
+        instances.selector.set_viewport(fovy, height);
+        instances.update(frustum_object, camera_position, workers);
 
-        std::vector<std::vector<glm::vec3>> lod_offsets(offsets_vbos.size());
-        for (int offset_index = 0; offset_index < frustum_offsets.size(); offset_index++) {
-            float distance = glm::distance(camera_position, frustum_offsets[offset_index]);
-            int lod_level = distance / 3;
-            if (lod_level >= lod_offsets.size())
-                lod_level = lod_offsets.size()-1;
-            lod_offsets[lod_level].push_back(frustum_offsets[offset_index]);
+        // Orphan last frame's storage, so that mapping doesn't wait for the draws still reading it
+        glBindBuffer(GL_ARRAY_BUFFER, instances_vbo);
+        glBufferData(GL_ARRAY_BUFFER, instance_offsets.size() * sizeof(glm::vec3), nullptr, GL_STREAM_DRAW);
+        if (instances.visible_count() > 0)
+        {
+            void * mapped = glMapBufferRange(GL_ARRAY_BUFFER, 0, instances.visible_count() * sizeof(glm::vec3),
+                GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+            instances.write({static_cast<glm::vec3 *>(mapped), instances.visible_count()}, workers);
+            glUnmapBuffer(GL_ARRAY_BUFFER);
         }
 
-        for (int lod_level = 0; lod_level < lod_offsets.size(); lod_level++) {
-            std::cout << lod_level << ": " << lod_offsets[lod_level].size() << ", ";
+        for (int lod_level = 0; lod_level < instances.lod_count(); lod_level++) {
+            std::cout << lod_level << ": " << instances.lod_instance_count(lod_level) << ", ";
 
-            glBindBuffer(GL_ARRAY_BUFFER, offsets_vbos[lod_level]);
-            glBufferData(GL_ARRAY_BUFFER, lod_offsets[lod_level].size() * sizeof(lod_offsets[lod_level][0]), lod_offsets[lod_level].data(), GL_DYNAMIC_DRAW);
+            glBindVertexArray(vaos[lod_level]);
+            glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<void *>(instances.lod_first(lod_level) * sizeof(glm::vec3)));
         }
-        std::cout << std::endl;
+        std::cout << "triangles: " << instances.triangle_count() << ", budget: " << instances.selector.pixel_budget << " px" << std::endl;
 
         glUseProgram(program);
         glUniformMatrix4fv(model_location, 1, GL_FALSE, reinterpret_cast<float *>(&model));
@@ -402,13 +425,13 @@ int main() try
 
         glBindTexture(GL_TEXTURE_2D, texture);
 
-        for (int lod_level = 0; lod_level < lod_offsets.size(); lod_level++) {
+        for (int lod_level = 0; lod_level < instances.lod_count(); lod_level++) {
             auto const &mesh = input_model.meshes[lod_level];
             glBindVertexArray(vaos[lod_level]);
             glDrawElementsInstanced(GL_TRIANGLES,
                                     mesh.indices.count,
                                     mesh.indices.type,
-                                    reinterpret_cast<void *>(mesh.indices.view.offset), lod_offsets[lod_level].size());
+                                    reinterpret_cast<void *>(mesh.indices.view.offset), instances.lod_instance_count(lod_level));
         }
 
         glEndQuery(GL_TIME_ELAPSED);
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <glm/vec3.hpp>
+
+#include <vector>
+#include <span>
+#include <cstdint>
+
+// How far a simplified mesh strays from the original: the largest distance from
+// a vertex of either mesh to the surface of the other (the Hausdorff distance,
+// measured at vertices). This is the geometric error of a LOD, in model units;
+// divided by the distance to the camera and scaled to the viewport it is the
+// error on screen in pixels.
+float mesh_distance(std::span<glm::vec3 const> positions_a, std::span<std::uint32_t const> indices_a,
+	std::span<glm::vec3 const> positions_b, std::span<std::uint32_t const> indices_b);
+
+// The one-sided part: the largest distance from `points` to the triangles
+float max_distance_to_mesh(std::span<glm::vec3 const> points,
+	std::span<glm::vec3 const> positions, std::span<std::uint32_t const> indices);
@@ -0,0 +1,246 @@
+#include "gltf_loader.hpp"
+#include "frustum_culling.hpp"
+#include "instance_bvh.hpp"
+#include "instance_pipeline.hpp"
+#include "lod_selector.hpp"
+#include "allocation_counter.hpp"
+
+#include <glm/ext/matrix_transform.hpp>
+#include <glm/ext/matrix_clip_space.hpp>
+#include <glm/ext/scalar_constants.hpp>
+
+#include <iostream>
+#include <chrono>
+#include <string>
+#include <cstdlib>
+#include <algorithm>
+#include <tuple>
+#include <cmath>
+
+// Usage: pipeline_benchmark [--frames N] [--instances N] [--threads N] [file.gltf]
+// Runs the cull -> LOD -> compact instance pipeline of practice14 over a grid of
+// instances of the model's first mesh, for a camera turning around near the middle
+// and moving back and forth, on one thread and on a pool. Compares it with the way
+// practice14 used to do it (a flat cull into a vector, then a vector of offsets per
+// LOD by distance), checks that every LOD gets the same instances as a serial
+// screen-space error selection, and counts the heap allocations made by the
+// pipeline's frames, failing if there are any. Also prints the triangles submitted
+// per frame with either LOD choice, and how many instances change LOD per frame
+// with and without hysteresis.
+
+namespace
+{
+
+	struct view
+	{
+		frustum f;
+		glm::vec3 camera_position;
+	};
+
+	view make_view(int frame)
+	{
+		// A slow dolly with a small wobble on top, which is what makes LODs flicker
+		glm::vec3 const camera_position{0.3f, 1.5f, 3.f + 2.f * std::sin(frame * 0.01f) + 0.05f * std::sin(frame * 2.f)};
+		glm::mat4 const projection = glm::perspective(glm::pi<float>() / 2.f, 16.f / 9.f, 0.1f, 100.f);
+		glm::mat4 view(1.f);
+		view = glm::rotate(view, frame * 0.01f, {0.f, 1.f, 0.f});
+		view = glm::translate(view, -camera_position);
+		return {frustum(projection * view), camera_position};
+	}
+
+	bool vec3_less(glm::vec3 const & a, glm::vec3 const & b)
+	{
+		return std::tie(a.x, a.y, a.z) < std::tie(b.x, b.y, b.z);
+	}
+
+}
+
+int main(int argc, char ** argv) try
+{
+	int frames = 200;
+	std::size_t instance_count = 1000000;
+	std::size_t threads = 0;
+	std::filesystem::path path = PROJECT_ROOT "/bunny/bunny.gltf";
+
+	for (int i = 1; i < argc; ++i)
+	{
+		if (argv[i] == std::string("--frames") && i + 1 < argc)
+			frames = std::max(1, std::atoi(argv[++i]));
+		else if (argv[i] == std::string("--instances") && i + 1 < argc)
+			instance_count = std::max(1ll, std::atoll(argv[++i]));
+		else if (argv[i] == std::string("--threads") && i + 1 < argc)
+			threads = std::max(1, std::atoi(argv[++i]));
+		else
+			path = argv[i];
+	}
+
+	auto const model = load_gltf(path);
+	if (model.meshes.empty())
+		throw std::runtime_error("No meshes in " + path.string());
+
+	std::size_t const lod_count = model.meshes.size();
+	std::size_t const side = std::ceil(std::sqrt(static_cast<double>(instance_count)));
+
+	std::vector<glm::vec3> offsets(instance_count);
+	instance_bounds bounds;
+	bounds.reserve(instance_count);
+	for (std::size_t i = 0; i < instance_count; ++i)
+	{
+		offsets[i] = {float(i % side) - side / 2, 0.f, float(i / side) - side / 2};
+		bounds.push_back(model.meshes[0].min + offsets[i], model.meshes[0].max + offsets[i]);
+	}
+
+	instance_bvh const bvh(bounds);
+
+	worker_pool single_thread(1);
+	worker_pool pool(threads);
+
+	lod_selector selector(measure_lod_levels(model));
+	selector.set_viewport(glm::pi<float>() / 2.f, 1080.f);
+
+	instance_pipeline pipeline(bvh, bounds, offsets, selector, pool.size());
+	std::vector<glm::vec3> instance_buffer(instance_count);
+
+	float sum = 0.f;
+	double triangles = 0.0;
+	auto run_pipeline = [&](instance_pipeline & pipeline, worker_pool & pool, int frame){
+		auto const v = make_view(frame);
+		pipeline.update(v.f, v.camera_position, pool);
+		pipeline.write(instance_buffer, pool);
+		sum += pipeline.visible_count();
+		triangles += pipeline.triangle_count();
+	};
+
+	// The old practice14 frame
+	constexpr float lod_distance = 3.f;
+	std::vector<std::uint32_t> visible(instance_count);
+	auto run_reference = [&](int frame, std::vector<std::vector<glm::vec3>> & lod_offsets){
+		auto const v = make_view(frame);
+		std::vector<glm::vec3> frustum_offsets;
+		std::size_t const count = cull_planes(v.f, bounds, visible);
+		for (std::size_t k = 0; k < count; ++k)
+			frustum_offsets.push_back(offsets[visible[k]]);
+
+		lod_offsets.assign(lod_count, {});
+		for (auto const & offset : frustum_offsets)
+		{
+			std::size_t lod = glm::distance(v.camera_position, offset) / lod_distance;
+			lod = std::min(lod, lod_count - 1);
+			lod_offsets[lod].push_back(offset);
+			triangles += selector[lod].triangle_count;
+		}
+		sum += frustum_offsets.size();
+	};
+
+	// The screen-space error selection of the pipeline, serially; returns how many
+	// instances visible in the previous frame too changed LOD
+	auto run_selection = [&](lod_selector const & selector, int frame, std::vector<std::uint8_t> & lods,
+		std::vector<int> & last_visible, std::vector<std::vector<glm::vec3>> & lod_offsets){
+		auto const v = make_view(frame);
+		std::size_t const count = cull_planes(v.f, bounds, visible);
+
+		std::size_t changes = 0;
+		lod_offsets.assign(lod_count, {});
+		for (std::size_t k = 0; k < count; ++k)
+		{
+			std::uint32_t const i = visible[k];
+			glm::vec3 const center{bounds.center_x[i], bounds.center_y[i], bounds.center_z[i]};
+			glm::vec3 const extent{bounds.extent_x[i], bounds.extent_y[i], bounds.extent_z[i]};
+			float const distance = glm::length(glm::max(glm::abs(v.camera_position - center) - extent, glm::vec3(0.f)));
+
+			std::size_t const lod = selector.select(distance, lods[i]);
+			changes += (lod != lods[i] && last_visible[i] == frame - 1);
+			lods[i] = lod;
+			last_visible[i] = frame;
+			lod_offsets[lod].push_back(offsets[i]);
+		}
+		return changes;
+	};
+
+	auto time_frames = [&](auto && frame_body){
+		auto start = std::chrono::high_resolution_clock::now();
+		for (int frame = 0; frame < frames; ++frame)
+			frame_body(frame);
+		auto end = std::chrono::high_resolution_clock::now();
+		return std::chrono::duration_cast<std::chrono::duration<double>>(end - start).count() / frames;
+	};
+
+	std::vector<std::vector<glm::vec3>> lod_offsets;
+	double const reference_time = time_frames([&](int frame){ run_reference(frame, lod_offsets); });
+	double const distance_triangles = triangles / frames;
+
+	// Warm up, then count
+	run_pipeline(pipeline, single_thread, 0);
+	run_pipeline(pipeline, pool, 0);
+
+	triangles = 0.0;
+	std::size_t const allocations_before = allocation_count();
+	double const single_time = time_frames([&](int frame){ run_pipeline(pipeline, single_thread, frame); });
+	double const pool_time = time_frames([&](int frame){ run_pipeline(pipeline, pool, frame); });
+	std::size_t const allocations = allocation_count() - allocations_before;
+	double const screen_space_triangles = triangles / (2 * frames);
+
+	// The LODs depend on the previous frames, so both start from scratch and see the same ones
+	instance_pipeline checked(bvh, bounds, offsets, selector, pool.size());
+	std::vector<std::uint8_t> lods(instance_count, 0);
+	std::vector<int> last_visible(instance_count, -2);
+
+	lod_selector no_hysteresis = selector;
+	no_hysteresis.hysteresis = 0.f;
+	std::vector<std::uint8_t> lods_without_hysteresis(instance_count, 0);
+	std::vector<int> last_visible_without_hysteresis(instance_count, -2);
+	std::vector<std::vector<glm::vec3>> lod_offsets_without_hysteresis;
+
+	std::size_t mismatches = 0;
+	double changes = 0.0, changes_without_hysteresis = 0.0;
+	for (int frame = 0; frame < frames; ++frame)
+	{
+		run_pipeline(checked, pool, frame);
+		changes += run_selection(selector, frame, lods, last_visible, lod_offsets);
+		changes_without_hysteresis += run_selection(no_hysteresis, frame, lods_without_hysteresis,
+			last_visible_without_hysteresis, lod_offsets_without_hysteresis);
+
+		if (frame % 10 != 0)
+			continue;
+
+		for (std::size_t lod = 0; lod < lod_count; ++lod)
+		{
+			auto & expected = lod_offsets[lod];
+			std::vector<glm::vec3> actual(instance_buffer.begin() + checked.lod_first(lod),
+				instance_buffer.begin() + checked.lod_first(lod) + checked.lod_instance_count(lod));
+			std::sort(expected.begin(), expected.end(), vec3_less);
+			std::sort(actual.begin(), actual.end(), vec3_less);
+			mismatches += (expected != actual);
+		}
+	}
+
+	std::cout << path.string() << '\n';
+	std::cout << "    instances:            " << instance_count << '\n';
+	std::cout << "    lods:                 " << lod_count << '\n';
+	std::cout << "    visible:              " << pipeline.visible_count() << '\n';
+	std::cout << "    old frame:            " << reference_time * 1e6 << " us\n";
+	std::cout << "    pipeline, 1 thread:   " << single_time * 1e6 << " us\n";
+	std::cout << "    pipeline, " << pool.size() << " threads:  " << pool_time * 1e6 << " us\n";
+	std::cout << "    lod mismatches:       " << mismatches << '\n';
+	std::cout << "    lod errors:          ";
+	for (std::size_t lod = 0; lod < lod_count; ++lod)
+		std::cout << ' ' << selector[lod].error;
+	std::cout << '\n';
+	std::cout << "    triangles, distance:  " << distance_triangles << " per frame\n";
+	std::cout << "    triangles, " << selector.pixel_budget << " px:     " << screen_space_triangles << " per frame\n";
+	std::cout << "    lod changes:          " << changes / frames << " per frame\n";
+	std::cout << "    without hysteresis:   " << changes_without_hysteresis / frames << " per frame\n";
+	std::cout << "    checksum:             " << sum << '\n';
+	std::cout << "    allocations:          " << allocations << '\n';
+
+	if (allocations != 0)
+	{
+		std::cerr << "Steady-state frames allocated memory" << std::endl;
+		return EXIT_FAILURE;
+	}
+}
+catch (std::exception const & e)
+{
+	std::cerr << e.what() << std::endl;
+	return EXIT_FAILURE;
+}
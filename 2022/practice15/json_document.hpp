@@ -0,0 +1,40 @@
+#pragma once
+
+#include <rapidjson/document.h>
+
+#include <filesystem>
+#include <vector>
+#include <span>
+#include <string>
+
+// A JSON file parsed in place. The text is read with a single call into a buffer
+// that the document's strings point into, and every value is allocated from one
+// arena sized from the text, so parsing makes only a couple of allocations.
+// The document refers to its own buffers, so it can be neither copied nor moved.
+struct json_document
+{
+    using allocator = rapidjson::MemoryPoolAllocator<>;
+    using document_type = rapidjson::GenericDocument<rapidjson::UTF8<>, allocator>;
+    using value_type = document_type::ValueType;
+
+    explicit json_document(std::filesystem::path const & path);
+
+    // Parses a copy of the text, e.g. of the JSON chunk of a .glb; `name` is used in error messages
+    json_document(std::span<char const> text, std::string const & name);
+
+    json_document(json_document const &) = delete;
+    json_document & operator = (json_document const &) = delete;
+
+    value_type const & root() const { return document_; }
+    value_type const & operator[](char const * name) const { return document_[name]; }
+    bool HasMember(char const * name) const { return document_.HasMember(name); }
+
+private:
+    std::vector<char> text_;
+    std::vector<char> arena_;
+    allocator allocator_;
+    document_type document_;
+
+    // Takes null-terminated text
+    json_document(std::vector<char> && text, std::string const & name);
+};
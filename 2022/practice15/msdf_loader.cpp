@@ -1,21 +1,13 @@
 #include "msdf_loader.hpp"
 
-#include <rapidjson/document.h>
-#include <rapidjson/istreamwrapper.h>
+#include "json_document.hpp"
 
-#include <fstream>
 #include <stdexcept>
 #include <filesystem>
 
 msdf_font load_msdf_font(std::string const & path)
 {
-    rapidjson::Document document;
-
-    {
-        std::ifstream input(path, std::ios::binary);
-        rapidjson::IStreamWrapper stream(input);
-        document.ParseStream(stream);
-    }
+    json_document const document(path);
 
     msdf_font result;
 
@@ -14,8 +14,11 @@
 #include <vector>
 #include <map>
 #include <cmath>
+#include <cstring>
+#include <cstddef>
 
 #include "obj_parser.hpp"
+#include "vertex_quantization.hpp"
 #include "stb_image.h"
 
 std::string to_string(std::string_view str)
@@ -39,6 +42,11 @@ R"(#version 330 core
 uniform mat4 transform;
 uniform mat4 projection;
 
+// Identity for vertex_format::full, the mesh bounding box for vertex_format::packed
+uniform vec3 position_offset;
+uniform vec3 position_scale;
+uniform bool packed_normals;
+
 layout (location = 0) in vec3 in_position;
 layout (location = 1) in vec3 in_normal;
 layout (location = 2) in vec2 in_texcoord;
@@ -46,10 +54,13 @@ layout (location = 2) in vec2 in_texcoord;
 out vec3 normal;
 out vec2 texcoord;
 
+vec3 octahedral_decode(vec2 e);
+
 void main()
 {
-    gl_Position = projection * transform * vec4(in_position, 1.0);
-    normal = mat3(transform) * in_normal;
+    vec3 position = position_offset + position_scale * in_position;
+    gl_Position = projection * transform * vec4(position, 1.0);
+    normal = mat3(transform) * (packed_normals ? octahedral_decode(in_normal.xy) : in_normal);
     texcoord = in_texcoord;
 }
 )";
@@ -72,6 +83,36 @@ void main()
 }
 )";
 
+enum class vertex_format
+{
+    // obj_data::vertex, 32 bytes
+    full,
+    // packed_vertex, 16 bytes
+    packed,
+};
+
+// Expects the vertex buffer to be bound to GL_ARRAY_BUFFER
+void setup_vertex_attributes(vertex_format format)
+{
+    glEnableVertexAttribArray(0);
+    glEnableVertexAttribArray(1);
+    glEnableVertexAttribArray(2);
+
+    switch (format)
+    {
+    case vertex_format::full:
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(obj_data::vertex), (void*)offsetof(obj_data::vertex, position));
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(obj_data::vertex), (void*)offsetof(obj_data::vertex, normal));
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(obj_data::vertex), (void*)offsetof(obj_data::vertex, texcoord));
+        break;
+    case vertex_format::packed:
+        glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(packed_vertex), (void*)offsetof(packed_vertex, position));
+        glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, sizeof(packed_vertex), (void*)offsetof(packed_vertex, normal));
+        glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(packed_vertex), (void*)offsetof(packed_vertex, texcoord));
+        break;
+    }
+}
+
 GLuint create_shader(GLenum type, const char * source)
 {
     GLuint result = glCreateShader(type);
@@ -111,8 +152,17 @@ GLuint create_program(GLuint vertex_shader, GLuint fragment_shader)
     return result;
 }
 
-int main() try
+// Usage: practice5 [--packed]
+// With --packed, the cow is drawn from 16-byte quantized vertices instead of 32-byte float ones
+int main(int argc, char ** argv) try
 {
+    vertex_format format = vertex_format::full;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--packed") == 0)
+            format = vertex_format::packed;
+    }
+
     if (SDL_Init(SDL_INIT_VIDEO) != 0)
         sdl2_fail("SDL_Init: ");
 
@@ -151,7 +201,8 @@ int main() try
 
     glClearColor(0.8f, 0.8f, 1.f, 0.f);
 
-    auto vertex_shader = create_shader(GL_VERTEX_SHADER, vertex_shader_source);
+    std::string const full_vertex_shader_source = std::string(vertex_shader_source) + octahedral_decode_glsl;
+    auto vertex_shader = create_shader(GL_VERTEX_SHADER, full_vertex_shader_source.c_str());
     auto fragment_shader = create_shader(GL_FRAGMENT_SHADER, fragment_shader_source);
     auto program = create_program(vertex_shader, fragment_shader);
 
@@ -159,6 +210,9 @@ int main() try
     GLuint projection_location = glGetUniformLocation(program, "projection");
     GLuint color_texture_location = glGetUniformLocation(program, "sampler");
     GLuint time_location = glGetUniformLocation(program, "time");
+    GLuint position_offset_location = glGetUniformLocation(program, "position_offset");
+    GLuint position_scale_location = glGetUniformLocation(program, "position_scale");
+    GLuint packed_normals_location = glGetUniformLocation(program, "packed_normals");
 
     std::string project_root = PROJECT_ROOT;
     std::string cow_texture_path = project_root + "/cow.png";
@@ -183,16 +237,29 @@ int main() try
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
     glBindBuffer(GL_ARRAY_BUFFER, vbo);
 
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(obj_data::vertex), (void*)0);
+    setup_vertex_attributes(format);
 
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(obj_data::vertex), (void*)(3*sizeof(float)));
+    std::array<float, 3> position_offset{0.f, 0.f, 0.f};
+    std::array<float, 3> position_scale{1.f, 1.f, 1.f};
 
-    glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(obj_data::vertex), (void*)(6*sizeof(float)));
+    if (format == vertex_format::packed)
+    {
+        quantization_error error;
+        packed_obj_data packed_cow = pack_obj(cow, &error);
+
+        std::cout << "Packed " << packed_cow.vertices.size() << " vertices into "
+            << packed_cow.vertices.size() * sizeof(packed_vertex) << " bytes (was "
+            << cow.vertices.size() * sizeof(obj_data::vertex) << "), max error: position "
+            << error.position << ", normal " << error.normal * 180.0 / M_PI << " degrees, texcoord "
+            << error.texcoord << std::endl;
 
-    glBufferData(GL_ARRAY_BUFFER, cow.vertices.size() * sizeof(obj_data::vertex), cow.vertices.data(), GL_STATIC_DRAW);
+        position_offset = packed_cow.position_offset;
+        position_scale = packed_cow.position_scale;
+
+        glBufferData(GL_ARRAY_BUFFER, packed_cow.vertices.size() * sizeof(packed_vertex), packed_cow.vertices.data(), GL_STATIC_DRAW);
+    }
+    else
+        glBufferData(GL_ARRAY_BUFFER, cow.vertices.size() * sizeof(obj_data::vertex), cow.vertices.data(), GL_STATIC_DRAW);
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, cow.indices.size() * sizeof(uint32_t), cow.indices.data(), GL_STATIC_DRAW);
 
     size_t size = 512;
@@ -322,6 +389,9 @@ int main() try
         glUniformMatrix4fv(projection_location, 1, GL_TRUE, projection);
         glUniform1i(color_texture_location, 1);
         glUniform1f(time_location, time / 5);
+        glUniform3fv(position_offset_location, 1, position_offset.data());
+        glUniform3fv(position_scale_location, 1, position_scale.data());
+        glUniform1i(packed_normals_location, format == vertex_format::packed);
 
 
         glBindVertexArray(vao);
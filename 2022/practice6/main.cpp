@@ -13,6 +13,8 @@
 #include <chrono>
 #include <vector>
 #include <map>
+#include <cstring>
+#include <cstddef>
 #include <cmath>
 #include <fstream>
 #include <sstream>
@@ -28,6 +30,7 @@
 #include <glm/gtx/string_cast.hpp>
 
 #include "obj_parser.hpp"
+#include "vertex_quantization.hpp"
 #include "stb_image.h"
 
 std::string to_string(std::string_view str)
@@ -52,6 +55,11 @@ uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
 
+// Identity for vertex_format::full, the mesh bounding box for vertex_format::packed
+uniform vec3 position_offset;
+uniform vec3 position_scale;
+uniform bool packed_normals;
+
 layout (location = 0) in vec3 in_position;
 layout (location = 1) in vec3 in_normal;
 layout (location = 2) in vec2 in_texcoord;
@@ -60,11 +68,15 @@ out vec3 normal;
 out vec3 position;
 out vec2 texcoord;
 
+vec3 octahedral_decode(vec2 e);
+
 void main()
 {
-    gl_Position = projection * view * model * vec4(in_position, 1.0);
-    position = (model * vec4(in_position, 1.0)).xyz;
-    normal = normalize(mat3(model) * in_normal);
+    vec3 vertex_position = position_offset + position_scale * in_position;
+    vec3 vertex_normal = packed_normals ? octahedral_decode(in_normal.xy) : in_normal;
+    gl_Position = projection * view * model * vec4(vertex_position, 1.0);
+    position = (model * vec4(vertex_position, 1.0)).xyz;
+    normal = normalize(mat3(model) * vertex_normal);
     texcoord = in_texcoord;
 }
 )";
@@ -169,6 +181,82 @@ void main()
 }
 )";
 
+enum class vertex_format
+{
+    // obj_data::vertex, 32 bytes
+    full,
+    // packed_vertex, 16 bytes
+    packed,
+};
+
+// Expects the vertex buffer to be bound to GL_ARRAY_BUFFER
+void setup_vertex_attributes(vertex_format format)
+{
+    glEnableVertexAttribArray(0);
+    glEnableVertexAttribArray(1);
+    glEnableVertexAttribArray(2);
+
+    switch (format)
+    {
+    case vertex_format::full:
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(obj_data::vertex), (void*)offsetof(obj_data::vertex, position));
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(obj_data::vertex), (void*)offsetof(obj_data::vertex, normal));
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(obj_data::vertex), (void*)offsetof(obj_data::vertex, texcoord));
+        break;
+    case vertex_format::packed:
+        glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(packed_vertex), (void*)offsetof(packed_vertex, position));
+        glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, sizeof(packed_vertex), (void*)offsetof(packed_vertex, normal));
+        glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(packed_vertex), (void*)offsetof(packed_vertex, texcoord));
+        break;
+    }
+}
+
+// What the vertex shaders need to decode the vertices of a mesh
+struct vertex_dequantization
+{
+    vertex_format format = vertex_format::full;
+    std::array<float, 3> position_offset{0.f, 0.f, 0.f};
+    std::array<float, 3> position_scale{1.f, 1.f, 1.f};
+};
+
+// Uploads the vertices of `data` in `format` into the buffer bound to GL_ARRAY_BUFFER
+vertex_dequantization upload_vertices(obj_data const & data, vertex_format format)
+{
+    vertex_dequantization result;
+    result.format = format;
+
+    if (format == vertex_format::packed)
+    {
+        quantization_error error;
+        packed_obj_data packed = pack_obj(data, &error);
+
+        std::cout << "Packed " << packed.vertices.size() << " vertices into "
+            << packed.vertices.size() * sizeof(packed_vertex) << " bytes (was "
+            << data.vertices.size() * sizeof(obj_data::vertex) << "), max error: position "
+            << error.position << ", normal " << error.normal * 180.0 / M_PI << " degrees, texcoord "
+            << error.texcoord << std::endl;
+
+        result.position_offset = packed.position_offset;
+        result.position_scale = packed.position_scale;
+
+        glBufferData(GL_ARRAY_BUFFER, packed.vertices.size() * sizeof(packed_vertex), packed.vertices.data(), GL_STATIC_DRAW);
+    }
+    else
+        glBufferData(GL_ARRAY_BUFFER, data.vertices.size() * sizeof(obj_data::vertex), data.vertices.data(), GL_STATIC_DRAW);
+
+    return result;
+}
+
+// Sets position_offset, position_scale and packed_normals of a program whose vertex shader reads
+// the vertices (the ones it doesn't declare are ignored); leaves the program in use
+void set_dequantization_uniforms(GLuint program, vertex_dequantization const & dequantization)
+{
+    glUseProgram(program);
+    glUniform3fv(glGetUniformLocation(program, "position_offset"), 1, dequantization.position_offset.data());
+    glUniform3fv(glGetUniformLocation(program, "position_scale"), 1, dequantization.position_scale.data());
+    glUniform1i(glGetUniformLocation(program, "packed_normals"), dequantization.format == vertex_format::packed);
+}
+
 GLuint create_shader(GLenum type, const char * source)
 {
     GLuint result = glCreateShader(type);
@@ -208,8 +296,17 @@ GLuint create_program(GLuint vertex_shader, GLuint fragment_shader)
     return result;
 }
 
-int main() try
+// Usage: practice6 [--packed]
+// With --packed, the model is drawn from 16-byte quantized vertices instead of 32-byte float ones
+int main(int argc, char ** argv) try
 {
+    vertex_format format = vertex_format::full;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--packed") == 0)
+            format = vertex_format::packed;
+    }
+
     if (SDL_Init(SDL_INIT_VIDEO) != 0)
         sdl2_fail("SDL_Init: ");
 
@@ -246,7 +343,7 @@ int main() try
 
     glClearColor(0.8f, 0.8f, 1.f, 0.f);
 
-    auto dragon_vertex_shader = create_shader(GL_VERTEX_SHADER, dragon_vertex_shader_source);
+    auto dragon_vertex_shader = create_shader(GL_VERTEX_SHADER, (std::string(dragon_vertex_shader_source) + octahedral_decode_glsl).c_str());
     auto dragon_fragment_shader = create_shader(GL_FRAGMENT_SHADER, dragon_fragment_shader_source);
     auto dragon_program = create_program(dragon_vertex_shader, dragon_fragment_shader);
 
@@ -269,18 +366,14 @@ int main() try
 
     glGenBuffers(1, &dragon_vbo);
     glBindBuffer(GL_ARRAY_BUFFER, dragon_vbo);
-    glBufferData(GL_ARRAY_BUFFER, dragon.vertices.size() * sizeof(dragon.vertices[0]), dragon.vertices.data(), GL_STATIC_DRAW);
+    auto const dragon_dequantization = upload_vertices(dragon, format);
+    set_dequantization_uniforms(dragon_program, dragon_dequantization);
 
     glGenBuffers(1, &dragon_ebo);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, dragon_ebo);
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, dragon.indices.size() * sizeof(dragon.indices[0]), dragon.indices.data(), GL_STATIC_DRAW);
 
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(obj_data::vertex), (void*)(0));
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(obj_data::vertex), (void*)(12));
-    glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(obj_data::vertex), (void*)(24));
+    setup_vertex_attributes(format);
 
     auto rectangle_vertex_shader = create_shader(GL_VERTEX_SHADER, rectangle_vertex_shader_source);
     auto rectangle_fragment_shader = create_shader(GL_FRAGMENT_SHADER, rectangle_fragment_shader_source);
@@ -1,10 +1,19 @@
 #include "obj_parser.hpp"
+#include "obj_cache.hpp"
+#include "mapped_file.hpp"
 
 #include <string>
+#include <string_view>
 #include <sstream>
-#include <fstream>
 #include <stdexcept>
-#include <map>
+#include <charconv>
+#include <cstring>
+#include <limits>
+#include <optional>
+#include <algorithm>
+#include <thread>
+#include <exception>
+#include <functional>
 
 namespace
 {
@@ -17,143 +26,642 @@ namespace
         return os.str();
     }
 
-}
+    bool is_space(char c)
+    {
+        return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+    }
 
-obj_data parse_obj(std::filesystem::path const & path)
-{
-    std::ifstream is(path);
+    char const * skip_spaces(char const * p, char const * end)
+    {
+        while (p != end && is_space(*p))
+            ++p;
+        return p;
+    }
 
-    std::vector<std::array<float, 3>> positions;
-    std::vector<std::array<float, 3>> normals;
-    std::vector<std::array<float, 2>> texcoords;
+    // Number parsers work in place on the mapped file and advance `p` past the parsed value
 
-    std::map<std::array<std::int32_t, 3>, std::uint32_t> index_map;
+    bool read_float(char const * & p, char const * end, float & value)
+    {
+        p = skip_spaces(p, end);
+        if (p != end && *p == '+')
+            ++p;
 
-    obj_data result;
+        auto [next, error] = std::from_chars(p, end, value);
+        if (error == std::errc::invalid_argument)
+            return false;
 
-    std::string line;
-    std::size_t line_count = 0;
+        // Denormals and overflows are reported as out of range, but the value is still fully consumed
+        if (error == std::errc::result_out_of_range)
+            value = 0.f;
 
-    auto fail = [&](auto const & ... args){
-        throw std::runtime_error(to_string("Error parsing OBJ data, line ", line_count, ": ", args...));
-    };
+        p = next;
+        return true;
+    }
 
-    while (std::getline(is >> std::ws, line))
+    bool read_int(char const * & p, char const * end, std::int32_t & value)
     {
-        ++line_count;
+        if (p != end && *p == '+')
+            ++p;
 
-        if (line.empty()) continue;
+        auto [next, error] = std::from_chars(p, end, value);
+        if (error != std::errc())
+            return false;
 
-        if (line[0] == '#') continue;
+        p = next;
+        return true;
+    }
 
-        std::istringstream ls(std::move(line));
+    // Open addressing hash map from (position, texcoord, normal) index triples to output vertex indices
+    struct vertex_index_map
+    {
+        using key_type = std::array<std::int32_t, 3>;
 
-        std::string tag;
-        ls >> tag;
+        static constexpr std::uint32_t empty = -1;
 
-        if (tag == "v")
+        struct entry
         {
-            auto & p = positions.emplace_back();
-            ls >> p[0] >> p[1] >> p[2];
+            key_type key;
+            std::uint32_t value = empty;
+        };
+
+        std::vector<entry> entries = std::vector<entry>(1024);
+        std::size_t count = 0;
+
+        static std::size_t hash(key_type const & key)
+        {
+            std::uint64_t h = static_cast<std::uint32_t>(key[0]);
+            h = h * 0x9E3779B97F4A7C15ull ^ static_cast<std::uint32_t>(key[1]);
+            h = h * 0x9E3779B97F4A7C15ull ^ static_cast<std::uint32_t>(key[2]);
+            h ^= h >> 29;
+            h *= 0xBF58476D1CE4E5B9ull;
+            h ^= h >> 32;
+            return h;
         }
-        else if (tag == "vn")
+
+        // Returns the value stored for the key, inserting `value` if the key is new
+        std::uint32_t insert(key_type const & key, std::uint32_t value, bool & inserted)
         {
-            auto & n = normals.emplace_back();
-            ls >> n[0] >> n[1] >> n[2];
+            if (2 * (count + 1) > entries.size())
+                grow();
+
+            std::size_t const mask = entries.size() - 1;
+            for (std::size_t i = hash(key) & mask;; i = (i + 1) & mask)
+            {
+                auto & e = entries[i];
+                if (e.value == empty)
+                {
+                    e.key = key;
+                    e.value = value;
+                    ++count;
+                    inserted = true;
+                    return value;
+                }
+                if (e.key == key)
+                {
+                    inserted = false;
+                    return e.value;
+                }
+            }
         }
-        else if (tag == "vt")
+
+        void clear()
         {
-            auto & t = texcoords.emplace_back();
-            ls >> t[0] >> t[1];
+            std::fill(entries.begin(), entries.end(), entry{});
+            count = 0;
+        }
+
+        void grow()
+        {
+            std::vector<entry> old(entries.size() * 2);
+            std::swap(old, entries);
+
+            std::size_t const mask = entries.size() - 1;
+            for (auto const & e : old)
+            {
+                if (e.value == empty) continue;
+
+                std::size_t i = hash(e.key) & mask;
+                while (entries[i].value != empty)
+                    i = (i + 1) & mask;
+                entries[i] = e;
+            }
         }
-        else if (tag == "f")
+    };
+
+    std::string_view read_tag(char const * & p, char const * end)
+    {
+        char const * begin = p;
+        while (p != end && !is_space(*p))
+            ++p;
+        return {begin, static_cast<std::size_t>(p - begin)};
+    }
+
+    // Marks a texcoord or normal index that is absent from a face corner
+    constexpr std::int32_t no_index = std::numeric_limits<std::int32_t>::min();
+
+    struct parse_error
+    {
+        std::size_t line;
+        std::string message;
+    };
+
+    // Calls the visitor for every v/vt/vn record and face corner in the text and
+    // returns the number of lines; throws parse_error for a malformed line
+    template <typename Visitor>
+    std::size_t parse_records(std::string_view text, Visitor & visitor)
+    {
+        std::size_t line_count = 0;
+
+        auto fail = [&](auto const & ... args){
+            throw parse_error{line_count, to_string(args...)};
+        };
+
+        char const * p = text.data();
+        char const * const text_end = p + text.size();
+
+        while (p != text_end)
         {
-            std::vector<std::uint32_t> vertices;
+            char const * end = static_cast<char const *>(std::memchr(p, '\n', text_end - p));
+            if (!end)
+                end = text_end;
 
-            while (ls)
+            ++line_count;
+
+            char const * next_line = (end == text_end) ? text_end : end + 1;
+
+            p = skip_spaces(p, end);
+
+            if (p == end || *p == '#')
             {
-                std::array<std::int32_t, 3> index{0, 0, 0};
-                bool has_texcoord = false;
-                bool has_normal = false;
+                p = next_line;
+                continue;
+            }
 
-                ls >> index[0];
-                if (ls.eof()) break;
-                if (!ls)
-                    fail("expected position index");
+            auto const tag = read_tag(p, end);
 
-                if (!std::isspace(ls.peek()) && !ls.eof())
+            if (tag == "v")
+            {
+                std::array<float, 3> v;
+                if (!read_float(p, end, v[0]) || !read_float(p, end, v[1]) || !read_float(p, end, v[2]))
+                    fail("expected vertex position");
+                visitor.position(v);
+            }
+            else if (tag == "vn")
+            {
+                std::array<float, 3> n;
+                if (!read_float(p, end, n[0]) || !read_float(p, end, n[1]) || !read_float(p, end, n[2]))
+                    fail("expected vertex normal");
+                visitor.normal(n);
+            }
+            else if (tag == "vt")
+            {
+                std::array<float, 2> t;
+                if (!read_float(p, end, t[0]) || !read_float(p, end, t[1]))
+                    fail("expected vertex texcoord");
+                visitor.texcoord(t);
+            }
+            else if (tag == "f")
+            {
+                visitor.face(line_count);
+
+                while (true)
                 {
-                    if (ls.get() != '/')
-                        fail("expected '/'");
+                    p = skip_spaces(p, end);
+                    if (p == end)
+                        break;
 
-                    if (ls.peek() != '/')
+                    std::array<std::int32_t, 3> index{0, no_index, no_index};
+
+                    if (!read_int(p, end, index[0]))
+                        fail("expected position index");
+
+                    if (p != end && !is_space(*p))
                     {
-                        ls >> index[1];
-                        if (!ls)
-                            fail("expected texcoord index");
-                        has_texcoord = true;
+                        if (*p++ != '/')
+                            fail("expected '/'");
+
+                        if (p == end || *p != '/')
+                        {
+                            if (!read_int(p, end, index[1]))
+                                fail("expected texcoord index");
+
+                            if (p != end && !is_space(*p))
+                            {
+                                if (*p++ != '/')
+                                    fail("expected '/'");
 
-                        if (!std::isspace(ls.peek()) && !ls.eof())
+                                if (!read_int(p, end, index[2]))
+                                    fail("expected normal index");
+                            }
+                        }
+                        else
                         {
-                            if (ls.get() != '/')
-                                fail("expected '/'");
+                            ++p;
 
-                            ls >> index[2];
-                            if (!ls)
+                            if (!read_int(p, end, index[2]))
                                 fail("expected normal index");
-                            has_normal = true;
                         }
                     }
-                    else
-                    {
-                        ls.get();
 
-                        ls >> index[2];
-                        if (!ls)
-                            fail("expected normal index");
-                        has_normal = true;
-                    }
+                    visitor.corner(index);
                 }
 
-                if (index[0] > 0)
-                    --index[0];
-                else
-                    index[0] = positions.size() + index[0];
+                visitor.face_end();
+            }
 
-                if (has_texcoord)
-                {
-                    if (index[1] > 0)
-                        --index[1];
-                    else
-                        index[1] = texcoords.size() + index[1];
-                }
+            p = next_line;
+        }
+
+        return line_count;
+    }
+
+    // Converts a corner as written in the file to zero-based absolute indices, given
+    // the number of v/vt/vn records preceding it; absent indices become -1
+    template <typename Fail>
+    void resolve_corner(std::array<std::int32_t, 3> & index, std::array<std::int64_t, 3> const & count, Fail const & fail)
+    {
+        std::array<std::int64_t, 3> resolved;
+        for (std::size_t k = 0; k < 3; ++k)
+        {
+            if (index[k] == no_index)
+                resolved[k] = -1;
+            else if (index[k] > 0)
+                resolved[k] = index[k] - 1;
+            else
+                resolved[k] = count[k] + index[k];
+        }
+
+        if (resolved[0] < 0 || resolved[0] >= count[0])
+            fail("bad position index (", resolved[0], ")");
+
+        if (index[1] != no_index && (resolved[1] < 0 || resolved[1] >= count[1]))
+            fail("bad texcoord index (", resolved[1], ")");
+
+        if (index[2] != no_index && (resolved[2] < 0 || resolved[2] >= count[2]))
+            fail("bad normal index (", resolved[2], ")");
+
+        for (std::size_t k = 0; k < 3; ++k)
+            index[k] = static_cast<std::int32_t>(resolved[k]);
+    }
+
+    // A range of whole lines of the file, parsed independently of other chunks.
+    // Face corners are stored with the indices as written in the file; they are
+    // resolved once the number of v/vt/vn records in preceding chunks is known.
+    struct obj_chunk
+    {
+        std::string_view text;
+        std::size_t line_count = 0;
+
+        std::vector<std::array<float, 3>> positions;
+        std::vector<std::array<float, 3>> normals;
+        std::vector<std::array<float, 2>> texcoords;
+
+        struct face_record
+        {
+            std::uint32_t corner_count;
+            std::uint32_t line;
+            // Number of records in this chunk preceding the face, used to resolve relative indices
+            std::uint32_t position_count;
+            std::uint32_t texcoord_count;
+            std::uint32_t normal_count;
+        };
+
+        std::vector<face_record> faces;
+        std::vector<std::array<std::int32_t, 3>> corners;
+
+        std::optional<parse_error> error;
+
+        void position(std::array<float, 3> const & v) { positions.push_back(v); }
+        void normal(std::array<float, 3> const & n) { normals.push_back(n); }
+        void texcoord(std::array<float, 2> const & t) { texcoords.push_back(t); }
+
+        void face(std::size_t line)
+        {
+            faces.push_back({0, static_cast<std::uint32_t>(line),
+                static_cast<std::uint32_t>(positions.size()),
+                static_cast<std::uint32_t>(texcoords.size()),
+                static_cast<std::uint32_t>(normals.size())});
+        }
+
+        void corner(std::array<std::int32_t, 3> const & index)
+        {
+            corners.push_back(index);
+            ++faces.back().corner_count;
+        }
+
+        void face_end() {}
+    };
+
+    void parse_chunk(obj_chunk & chunk)
+    {
+        try
+        {
+            chunk.line_count = parse_records(chunk.text, chunk);
+        }
+        catch (parse_error & error)
+        {
+            chunk.error = std::move(error);
+        }
+    }
+
+    // Converts the corners of a chunk to zero-based absolute indices, given the
+    // number of v/vt/vn records in all preceding chunks
+    void resolve_chunk(obj_chunk & chunk, std::array<std::size_t, 3> const & base)
+    {
+        auto corner = chunk.corners.begin();
+
+        for (auto const & face : chunk.faces)
+        {
+            std::array<std::int64_t, 3> const count
+            {
+                static_cast<std::int64_t>(base[0] + face.position_count),
+                static_cast<std::int64_t>(base[1] + face.texcoord_count),
+                static_cast<std::int64_t>(base[2] + face.normal_count),
+            };
+
+            auto fail = [&](auto const & ... args){
+                throw parse_error{face.line, to_string(args...)};
+            };
+
+            for (std::uint32_t i = 0; i < face.corner_count; ++i, ++corner)
+                resolve_corner(*corner, count, fail);
+        }
+    }
+
+    // Single-pass visitor producing triangle batches for stream_obj
+    struct obj_stream
+    {
+        std::size_t batch_triangles;
+        std::function<void(obj_data const &)> const & callback;
+
+        obj_stream(std::size_t batch_triangles, std::function<void(obj_data const &)> const & callback)
+            : batch_triangles(batch_triangles)
+            , callback(callback)
+        {}
+
+        std::vector<std::array<float, 3>> positions;
+        std::vector<std::array<float, 3>> normals;
+        std::vector<std::array<float, 2>> texcoords;
+
+        std::size_t line = 0;
+        std::vector<std::array<std::int32_t, 3>> face_corners;
+
+        vertex_index_map index_map;
+        obj_data batch;
+
+        void position(std::array<float, 3> const & v) { positions.push_back(v); }
+        void normal(std::array<float, 3> const & n) { normals.push_back(n); }
+        void texcoord(std::array<float, 2> const & t) { texcoords.push_back(t); }
+
+        void face(std::size_t face_line)
+        {
+            line = face_line;
+            face_corners.clear();
+        }
+
+        void corner(std::array<std::int32_t, 3> index)
+        {
+            std::array<std::int64_t, 3> const count
+            {
+                static_cast<std::int64_t>(positions.size()),
+                static_cast<std::int64_t>(texcoords.size()),
+                static_cast<std::int64_t>(normals.size()),
+            };
+
+            resolve_corner(index, count, [&](auto const & ... args){
+                throw parse_error{line, to_string(args...)};
+            });
+
+            face_corners.push_back(index);
+        }
+
+        void face_end()
+        {
+            for (std::size_t i = 1; i + 1 < face_corners.size(); ++i)
+            {
+                if (batch.indices.size() >= 3 * batch_triangles)
+                    flush();
+
+                // Fetching all three corners after a flush keeps large polygons valid across batches
+                std::uint32_t const v0 = add_vertex(face_corners[0]);
+                std::uint32_t const v1 = add_vertex(face_corners[i]);
+                std::uint32_t const v2 = add_vertex(face_corners[i + 1]);
+
+                batch.indices.push_back(v0);
+                batch.indices.push_back(v1);
+                batch.indices.push_back(v2);
+            }
+        }
+
+        std::uint32_t add_vertex(std::array<std::int32_t, 3> const & index)
+        {
+            bool inserted;
+            std::uint32_t const vertex_index = index_map.insert(index, batch.vertices.size(), inserted);
+            if (inserted)
+            {
+                auto & v = batch.vertices.emplace_back();
+
+                v.position = positions[index[0]];
+
+                if (index[1] != -1)
+                    v.texcoord = texcoords[index[1]];
                 else
-                    index[1] = -1;
+                    v.texcoord = {0.f, 0.f};
 
-                if (has_normal)
-                {
-                    if (index[2] > 0)
-                        --index[2];
-                    else
-                        index[2] = normals.size() + index[2];
-                }
+                if (index[2] != -1)
+                    v.normal = normals[index[2]];
                 else
-                    index[2] = -1;
+                    v.normal = {0.f, 0.f, 0.f};
+            }
+            return vertex_index;
+        }
 
-                if (index[0] >= positions.size())
-                    fail("bad position index (", index[0], ")");
+        void flush()
+        {
+            if (batch.indices.empty())
+                return;
 
-                if (index[1] != -1 && index[1] >= texcoords.size())
-                    fail("bad texcoord index (", index[1], ")");
+            callback(batch);
 
-                if (index[2] != -1 && index[2] >= normals.size())
-                    fail("bad normal index (", index[2], ")");
+            batch.vertices.clear();
+            batch.indices.clear();
+            index_map.clear();
+        }
+    };
 
-                auto it = index_map.find(index);
-                if (it == index_map.end())
-                {
-                    it = index_map.insert({index, result.vertices.size()}).first;
+    template <typename Function>
+    void parallel_for(std::size_t count, Function const & function)
+    {
+        std::vector<std::exception_ptr> errors(count);
+
+        auto run = [&](std::size_t i)
+        {
+            try
+            {
+                function(i);
+            }
+            catch (...)
+            {
+                errors[i] = std::current_exception();
+            }
+        };
+
+        std::vector<std::thread> threads;
+        for (std::size_t i = 1; i < count; ++i)
+            threads.emplace_back(run, i);
+
+        if (count > 0)
+            run(0);
+
+        for (auto & thread : threads)
+            thread.join();
+
+        for (auto const & error : errors)
+            if (error)
+                std::rethrow_exception(error);
+    }
+
+    // Chunks smaller than this are not worth a separate thread
+    constexpr std::size_t min_chunk_size = 1 << 20;
+
+    std::vector<obj_chunk> split_chunks(std::string_view text, unsigned int thread_count)
+    {
+        if (thread_count == 0)
+            thread_count = std::max(1u, std::thread::hardware_concurrency());
+
+        std::size_t const chunk_count = std::max<std::size_t>(1, std::min<std::size_t>(thread_count, text.size() / min_chunk_size));
+
+        std::vector<obj_chunk> chunks;
+        chunks.reserve(chunk_count);
+
+        std::size_t begin = 0;
+        for (std::size_t i = 1; i <= chunk_count && begin < text.size(); ++i)
+        {
+            std::size_t end = text.size();
+            if (i < chunk_count)
+            {
+                end = text.find('\n', std::max(begin, text.size() * i / chunk_count));
+                end = (end == std::string_view::npos) ? text.size() : end + 1;
+            }
+
+            chunks.emplace_back().text = text.substr(begin, end - begin);
+            begin = end;
+        }
+
+        return chunks;
+    }
+
+}
+
+obj_data parse_obj(std::filesystem::path const & path, obj_parse_stats * stats, obj_parse_options const & options)
+{
+    if (options.use_cache)
+    {
+        if (auto cached = load_obj_cache(path, stats))
+            return std::move(*cached);
+    }
+
+    mapped_file file(path);
 
+    auto chunks = split_chunks(file.view(), options.thread_count);
+
+    parallel_for(chunks.size(), [&](std::size_t i){ parse_chunk(chunks[i]); });
+
+    // Only chunks up to the first one that failed to parse are used: its error
+    // is reported unless an earlier face refers to a bad index
+    std::size_t chunk_count = 0;
+    while (chunk_count < chunks.size())
+    {
+        if (chunks[chunk_count++].error)
+            break;
+    }
+
+    std::vector<std::array<std::size_t, 3>> bases(chunk_count);
+    std::vector<std::size_t> line_bases(chunk_count);
+    std::array<std::size_t, 3> totals{0, 0, 0};
+    for (std::size_t i = 0; i < chunk_count; ++i)
+    {
+        bases[i] = totals;
+        totals[0] += chunks[i].positions.size();
+        totals[1] += chunks[i].texcoords.size();
+        totals[2] += chunks[i].normals.size();
+
+        if (i > 0)
+            line_bases[i] = line_bases[i - 1] + chunks[i - 1].line_count;
+    }
+
+    parallel_for(chunk_count, [&](std::size_t i)
+    {
+        try
+        {
+            resolve_chunk(chunks[i], bases[i]);
+        }
+        catch (parse_error & error)
+        {
+            chunks[i].error = std::move(error);
+        }
+    });
+
+    for (std::size_t i = 0; i < chunk_count; ++i)
+    {
+        if (auto const & error = chunks[i].error)
+            throw std::runtime_error(to_string("Error parsing OBJ data, line ", line_bases[i] + error->line, ": ", error->message));
+    }
+
+    std::vector<std::array<float, 3>> positions;
+    std::vector<std::array<float, 3>> normals;
+    std::vector<std::array<float, 2>> texcoords;
+
+    if (chunk_count == 1)
+    {
+        positions = std::move(chunks[0].positions);
+        normals = std::move(chunks[0].normals);
+        texcoords = std::move(chunks[0].texcoords);
+    }
+    else
+    {
+        positions.reserve(totals[0]);
+        texcoords.reserve(totals[1]);
+        normals.reserve(totals[2]);
+
+        for (auto & chunk : chunks)
+        {
+            positions.insert(positions.end(), chunk.positions.begin(), chunk.positions.end());
+            texcoords.insert(texcoords.end(), chunk.texcoords.begin(), chunk.texcoords.end());
+            normals.insert(normals.end(), chunk.normals.begin(), chunk.normals.end());
+
+            chunk.positions = {};
+            chunk.texcoords = {};
+            chunk.normals = {};
+        }
+    }
+
+    // Deduplication assigns vertex indices in order of first appearance, so it
+    // walks the chunks sequentially to stay identical to a single-threaded parse
+
+    vertex_index_map index_map;
+
+    obj_data result;
+
+    std::size_t face_corners = 0;
+
+    for (std::size_t c = 0; c < chunk_count; ++c)
+    {
+        auto corner = chunks[c].corners.begin();
+
+        for (auto const & face : chunks[c].faces)
+        {
+            std::uint32_t first = 0;
+            std::uint32_t previous = 0;
+
+            for (std::uint32_t i = 0; i < face.corner_count; ++i, ++corner)
+            {
+                auto const & index = *corner;
+
+                bool inserted;
+                std::uint32_t const vertex_index = index_map.insert(index, result.vertices.size(), inserted);
+                if (inserted)
+                {
                     auto & v = result.vertices.emplace_back();
 
                     v.position = positions[index[0]];
@@ -169,17 +677,52 @@ obj_data parse_obj(std::filesystem::path const & path)
                         v.normal = {0.f, 0.f, 0.f};
                 }
 
-                vertices.push_back(it->second);
-            }
+                if (i == 0)
+                    first = vertex_index;
+                else if (i >= 2)
+                {
+                    result.indices.push_back(first);
+                    result.indices.push_back(previous);
+                    result.indices.push_back(vertex_index);
+                }
 
-            for (std::size_t i = 1; i + 1 < vertices.size(); ++i)
-            {
-                result.indices.push_back(vertices[0]);
-                result.indices.push_back(vertices[i]);
-                result.indices.push_back(vertices[i + 1]);
+                previous = vertex_index;
             }
+
+            face_corners += face.corner_count;
         }
     }
 
+    obj_parse_stats result_stats;
+    result_stats.face_corners = face_corners;
+    result_stats.unique_vertices = result.vertices.size();
+
+    if (options.use_cache)
+        save_obj_cache(path, result, result_stats);
+
+    if (stats)
+        *stats = result_stats;
+
     return result;
 }
+
+void stream_obj(std::filesystem::path const & path, std::size_t batch_triangles, std::function<void(obj_data const &)> const & callback)
+{
+    if (batch_triangles == 0)
+        throw std::invalid_argument("OBJ stream batch size must be positive");
+
+    mapped_file file(path);
+
+    obj_stream stream(batch_triangles, callback);
+
+    try
+    {
+        parse_records(file.view(), stream);
+    }
+    catch (parse_error const & error)
+    {
+        throw std::runtime_error(to_string("Error parsing OBJ data, line ", error.line, ": ", error.message));
+    }
+
+    stream.flush();
+}
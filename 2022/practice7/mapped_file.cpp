@@ -0,0 +1,143 @@
+#include "mapped_file.hpp"
+
+#include <stdexcept>
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+mapped_file::mapped_file(std::filesystem::path const & path, access pattern)
+{
+    DWORD const flags = (pattern == access::sequential) ? FILE_FLAG_SEQUENTIAL_SCAN : FILE_FLAG_RANDOM_ACCESS;
+    HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, flags, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        throw std::runtime_error("Failed to open " + path.string());
+
+    file_ = file;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size))
+    {
+        reset();
+        throw std::runtime_error("Failed to get size of " + path.string());
+    }
+
+    // Zero-sized files cannot be mapped
+    if (size.QuadPart == 0)
+        return;
+
+    mapping_ = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping_)
+    {
+        reset();
+        throw std::runtime_error("Failed to map " + path.string());
+    }
+
+    data_ = static_cast<char const *>(MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+    if (!data_)
+    {
+        reset();
+        throw std::runtime_error("Failed to map " + path.string());
+    }
+
+    size_ = static_cast<std::size_t>(size.QuadPart);
+}
+
+void mapped_file::reset()
+{
+    if (data_)
+        UnmapViewOfFile(data_);
+    if (mapping_)
+        CloseHandle(mapping_);
+    if (file_)
+        CloseHandle(file_);
+
+    data_ = nullptr;
+    size_ = 0;
+    mapping_ = nullptr;
+    file_ = nullptr;
+}
+
+#else
+
+mapped_file::mapped_file(std::filesystem::path const & path, access pattern)
+{
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd == -1)
+        throw std::runtime_error("Failed to open " + path.string());
+
+    struct stat info;
+    if (::fstat(fd, &info) != 0)
+    {
+        ::close(fd);
+        throw std::runtime_error("Failed to get size of " + path.string());
+    }
+
+    // Zero-sized files cannot be mapped
+    if (info.st_size == 0)
+    {
+        ::close(fd);
+        return;
+    }
+
+    void * data = ::mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+
+    if (data == MAP_FAILED)
+        throw std::runtime_error("Failed to map " + path.string());
+
+    ::madvise(data, info.st_size, (pattern == access::sequential) ? MADV_SEQUENTIAL : MADV_WILLNEED);
+
+    data_ = static_cast<char const *>(data);
+    size_ = info.st_size;
+}
+
+void mapped_file::reset()
+{
+    if (data_)
+        ::munmap(const_cast<char *>(data_), size_);
+
+    data_ = nullptr;
+    size_ = 0;
+}
+
+#endif
+
+mapped_file::~mapped_file()
+{
+    reset();
+}
+
+mapped_file::mapped_file(mapped_file && other) noexcept
+    : data_(std::exchange(other.data_, nullptr))
+    , size_(std::exchange(other.size_, 0))
+#ifdef _WIN32
+    , file_(std::exchange(other.file_, nullptr))
+    , mapping_(std::exchange(other.mapping_, nullptr))
+#endif
+{}
+
+mapped_file & mapped_file::operator = (mapped_file && other) noexcept
+{
+    if (this != &other)
+    {
+        reset();
+        data_ = std::exchange(other.data_, nullptr);
+        size_ = std::exchange(other.size_, 0);
+#ifdef _WIN32
+        file_ = std::exchange(other.file_, nullptr);
+        mapping_ = std::exchange(other.mapping_, nullptr);
+#endif
+    }
+    return *this;
+}
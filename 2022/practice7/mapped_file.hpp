@@ -0,0 +1,45 @@
+#pragma once
+
+#include <filesystem>
+#include <string_view>
+#include <cstddef>
+
+// Read-only memory mapping of a whole file
+struct mapped_file
+{
+    enum class access
+    {
+        // Read once from start to end, e.g. by a parser
+        sequential,
+        // Kept mapped and read in any order, e.g. as the backing store of a loaded model;
+        // the whole file is read ahead
+        random,
+    };
+
+    mapped_file() = default;
+    explicit mapped_file(std::filesystem::path const & path, access pattern = access::sequential);
+    ~mapped_file();
+
+    mapped_file(mapped_file && other) noexcept;
+    mapped_file & operator = (mapped_file && other) noexcept;
+
+    mapped_file(mapped_file const &) = delete;
+    mapped_file & operator = (mapped_file const &) = delete;
+
+    char const * data() const { return data_; }
+    std::size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    std::string_view view() const { return {data_, size_}; }
+
+private:
+    char const * data_ = nullptr;
+    std::size_t size_ = 0;
+
+#ifdef _WIN32
+    void * file_ = nullptr;
+    void * mapping_ = nullptr;
+#endif
+
+    void reset();
+};
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "obj_parser.hpp"
+
+#include <array>
+#include <vector>
+#include <cstdint>
+
+// Compact 16-byte alternative to the 32-byte obj_data::vertex, set up as
+//     position: 3 x GL_UNSIGNED_SHORT, normalized, offset 0
+//     normal:   2 x GL_SHORT, normalized, offset 8
+//     texcoord: 2 x GL_HALF_FLOAT, offset 12
+// The shader reconstructs the position as position_offset + position_scale * in_position
+// and the normal with octahedral_decode (see octahedral_decode_glsl).
+struct packed_vertex
+{
+    // Position within the mesh bounding box, 0 to 65535 along each axis
+    std::array<std::uint16_t, 3> position;
+    std::uint16_t padding;
+    // Unit normal, octahedral-encoded into the [-1, 1] square
+    std::array<std::int16_t, 2> normal;
+    // Half-precision floats
+    std::array<std::uint16_t, 2> texcoord;
+};
+
+static_assert(sizeof(packed_vertex) == 16);
+
+struct packed_obj_data
+{
+    std::vector<packed_vertex> vertices;
+    std::vector<std::uint32_t> indices;
+
+    // Dequantization: position = position_offset + position_scale * (packed.position / 65535)
+    std::array<float, 3> position_offset;
+    std::array<float, 3> position_scale;
+};
+
+// Largest differences between the original vertices and the decoded packed ones
+struct quantization_error
+{
+    // Distance, in mesh units
+    float position = 0.f;
+    // Angle between normals, in radians; zero normals are skipped
+    float normal = 0.f;
+    // Largest difference of any component
+    float texcoord = 0.f;
+};
+
+std::uint16_t float_to_half(float value);
+float half_to_float(std::uint16_t value);
+
+std::array<std::int16_t, 2> octahedral_encode(std::array<float, 3> const & normal);
+std::array<float, 3> octahedral_decode(std::array<std::int16_t, 2> const & normal);
+
+packed_obj_data pack_obj(obj_data const & data, quantization_error * error = nullptr);
+obj_data unpack_obj(packed_obj_data const & data);
+
+// GLSL function `vec3 octahedral_decode(vec2 e)` matching octahedral_decode,
+// to be pasted into vertex shaders that read packed normals
+extern const char octahedral_decode_glsl[];
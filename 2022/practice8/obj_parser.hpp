@@ -3,6 +3,7 @@
 #include <array>
 #include <vector>
 #include <filesystem>
+#include <functional>
 
 struct obj_data
 {
@@ -17,4 +18,32 @@ struct obj_data
     std::vector<std::uint32_t> indices;
 };
 
-obj_data parse_obj(std::filesystem::path const & path);
+struct obj_parse_stats
+{
+    // Number of v/vt/vn corners referenced by face records
+    std::size_t face_corners = 0;
+    // Number of distinct corners, i.e. vertices in the output
+    std::size_t unique_vertices = 0;
+    // Whether the data was loaded from the binary cache instead of parsing the text
+    bool cached = false;
+};
+
+struct obj_parse_options
+{
+    // Large files are split at line boundaries and parsed on up to this many threads
+    // (0 means std::thread::hardware_concurrency()); the result does not depend on it
+    unsigned int thread_count = 0;
+
+    // Load from a fresh binary cache next to the source file if there is one,
+    // and write it after parsing otherwise (see obj_cache.hpp)
+    bool use_cache = true;
+};
+
+obj_data parse_obj(std::filesystem::path const & path, obj_parse_stats * stats = nullptr, obj_parse_options const & options = {});
+
+// Parses the file in a single pass and passes its triangles to `callback` in batches
+// of at most `batch_triangles` triangles. Each batch is an obj_data with vertices
+// deduplicated within that batch only; it is reused between calls, so copy out what
+// is needed. Apart from the batch, memory holds only the v/vt/vn records, which any
+// later face may refer to; the file itself is mapped, not read into memory.
+void stream_obj(std::filesystem::path const & path, std::size_t batch_triangles, std::function<void(obj_data const &)> const & callback);